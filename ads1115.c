@@ -16,292 +16,1718 @@
  * 
  * 				Continuous conversion mode is supported through
  * 				ADS1115_read_stream(), single shot through
- * 				ADS1115_get_single_conversion().
+ * 				ADS1115_get_single_conversion(). Smoothed and decimated
+ * 				streams are built on top in ads1115_filter.h.
+ * 
+ * 				All state is held in an ads1115_dev handle returned by
+ * 				ADS1115_init(), one per chip. Several handles may be open
+ * 				at once, on the same or different buses. A single handle
+ * 				must not be used from two threads at the same time.
  * 
  * Written on:	Raspbian GNU/Linux 8 (jessie)
  * 				gcc (Raspbian) 4.9.2
  * */
-#define _GNU_SOURCE			// clock_gettime(), clock_nanosleep() under -std=c11
+#define _GNU_SOURCE			// clock_gettime(), clock_nanosleep(), O_CLOEXEC under -std=c11
 #include "ads1115.h"
+#include "ads1115_internal.h"
 
-// pointer mask 
-uint8_t ui8_pointer_register_mask = POINTER_REGISTER_CONFIG; 
-
-// config masks
-uint8_t ui8_config_register_operation_mask = CONFIG_REGISTER_IDLE; 
-uint8_t	ui8_config_register_mult_mask = CONFIG_REGISTER_MULT_AIN_0; 
-uint8_t ui8_config_register_pga_mask = CONFIG_REGISTER_PGA_4_096;
-uint8_t ui8_config_register_conversion_mode_mask = CONFIG_REGISTER_SINGLE_CONVERSION;
-uint8_t ui8_config_register_conversion_rate_mask = CONFIG_REGISTER_SPS_32;
-uint8_t ui8_config_register_comparator_mode_mask = CONFIG_REGISTER_COMPARATOR_MODE_TRADITIONAL;
-uint8_t ui8_config_register_comparator_polarity_mask = CONFIG_REGISTER_COMPARATOR_POLARITY_LOW;
-uint8_t ui8_config_register_comparator_latch_mask = CONFIG_REGISTER_COMPARATOR_NON_LATCHING;
-uint8_t ui8_config_register_comparator_queue_mask = CONFIG_REGISTER_COMPARATOR_QUEUE_DISABLED;
-
-uint8_t ui8arr_write_buffer[3];
-uint8_t ui8arr_read_buffer[2];
-
-int i_ADS1115_handle;
-
-float f_resolution = (PGA_4_096V / 32768.0);
+// SIMD kernels for ADS1115_codes_to_volts(), scalar code covers the rest
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 // nominal data rates in SPS, indexed by (RATE_MASK >> 5)
 const int iarr_conversion_rate_sps[8] = {8, 16, 32, 64, 128, 250, 475, 860};
 
-// continuous mode state -- cleared whenever the config register must be rewritten
-uint8_t ui8_continuous_configured = 0;
-struct timespec ts_next_sample;
-	
-void ADS1115_close() {
-	puts("ADS1115_close");	
-	if (close(i_ADS1115_handle)) {
-		perror("ADS1115_close");
+// PGA settings from the narrowest to the widest range, see ADS1115_autorange_select()
+const uint8_t ui8arr_autorange_order[6] = {PGA_0_256, PGA_0_512, PGA_1_024, PGA_2_048, PGA_4_096, PGA_6_144};
+
+// trace configuration, see ADS1115_set_trace_sink()
+ads1115_trace_sink sink_ADS1115_trace = NULL;
+void *vp_ADS1115_trace_context = NULL;
+int i_ADS1115_trace_level = ADS1115_TRACE_NONE;
+
+// pointer bytes handed to the kernel by address, indexed by POINTER_MASK
+uint8_t ui8arr_pointer_values[4] = {
+	POINTER_REGISTER_CONVERSION, 
+	POINTER_REGISTER_CONFIG, 
+	POINTER_REGISTER_LOW_THRESHOLD, 
+	POINTER_REGISTER_HIGH_THRESHOLD
+	};
+	
+void ADS1115_trace_stderr(enum ADS1115_TRACE_LEVEL level, const char *message, void *context) {
+	(void)context;
+	fprintf(stderr, "ADS1115 [%d] %s\n", level, message);
+	}
+	
+void ADS1115_set_trace_sink(ads1115_trace_sink sink, void *context, enum ADS1115_TRACE_LEVEL level) {
+	// no sink means stderr, ADS1115_TRACE_NONE silences everything
+	sink_ADS1115_trace = (sink != NULL) ? sink : ADS1115_trace_stderr;
+	vp_ADS1115_trace_context = context;
+	i_ADS1115_trace_level = level;
+	}
+	
+void ADS1115_trace(enum ADS1115_TRACE_LEVEL level, const char *format, ...) {
+	char carr_temp_message[ADS1115_TRACE_MESSAGE_MAX];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(carr_temp_message, sizeof(carr_temp_message), format, args);
+	va_end(args);
+	sink_ADS1115_trace(level, carr_temp_message, vp_ADS1115_trace_context);
+	}
+	
+int ADS1115_linux_transfer(void *context, struct i2c_msg *msgs, int count) {
+	int i_handle = (int)(intptr_t)context;
+	if (count == 1 && (msgs[0].flags & I2C_M_RD)) {
+		return (read(i_handle, msgs[0].buf, msgs[0].len) == msgs[0].len) ? ADS1115_OK : ADS1115_ERROR_IO;
+		}
+	if (count == 1) {
+		return (write(i_handle, msgs[0].buf, msgs[0].len) == msgs[0].len) ? ADS1115_OK : ADS1115_ERROR_IO;
+		}
+	// all messages go out in one kernel call, joined by repeated starts
+	struct i2c_rdwr_ioctl_data rdwr = {msgs, count};
+	return (ioctl(i_handle, I2C_RDWR, &rdwr) == count) ? ADS1115_OK : ADS1115_ERROR_IO;
+	}
+	
+void ADS1115_linux_close(void *context) {
+	if (close((int)(intptr_t)context)) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_close: %s", strerror(errno));
 		}	
 	}
 	
-void ADS1115_set_pointer_register(enum POINTER_MASK mode) {
-	puts("ADS1115_set_pointer_register");
-	ui8_pointer_register_mask = mode;
-	printf("pointer register mask set to: %d\n", mode);
+void ADS1115_close(ads1115_dev *dev) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_close");	
+	if (dev->transport.close != NULL) {
+		dev->transport.close(dev->transport.context);
+		}
+	if (dev->ui8_alert_owned) {
+		close(dev->i_alert_fd);
+		}
+	free(dev);
 	}
 	
-void ADS1115_set_conversion_rate(enum RATE_MASK sps) {
-	puts("ADS1115_set_conversion_rate");	
-	ui8_config_register_conversion_rate_mask = sps;	
-	printf("conversion rate mask set to: %d\n", ui8_config_register_conversion_rate_mask);
-	ui8_continuous_configured = 0;
+void ADS1115_set_conversion_rate(ads1115_dev *dev, enum RATE_MASK sps) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_set_conversion_rate");	
+	dev->ui8_config_register_conversion_rate_mask = sps;	
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "conversion rate mask set to: %d", dev->ui8_config_register_conversion_rate_mask);
+	dev->ui8_continuous_configured = 0;
 	}
 	
-void ADS1115_set_conversion_mode(enum CONVERSION_MODE_MASK mode) {
-	puts("ADS1115_set_conversion_mode");
-	ui8_config_register_conversion_mode_mask = mode;
-	printf("conversion mode mask set to: %d\n", ui8_config_register_conversion_mode_mask);
-	ui8_continuous_configured = 0;
+void ADS1115_set_conversion_mode(ads1115_dev *dev, enum CONVERSION_MODE_MASK mode) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_set_conversion_mode");
+	dev->ui8_config_register_conversion_mode_mask = mode;
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "conversion mode mask set to: %d", dev->ui8_config_register_conversion_mode_mask);
+	dev->ui8_continuous_configured = 0;
 	}
 	
-void ADS1115_set_multiplex(enum MULT_MASK mult) {
-	puts("ADS1115_set_multiplex");
-	ui8_config_register_mult_mask = mult;
-	printf("multiplex mask set to: %d\n", ui8_config_register_mult_mask);
-	ui8_continuous_configured = 0;
+void ADS1115_set_multiplex(ads1115_dev *dev, enum MULT_MASK mult) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_set_multiplex");
+	dev->ui8_config_register_mult_mask = mult;
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "multiplex mask set to: %d", dev->ui8_config_register_mult_mask);
+	dev->ui8_continuous_configured = 0;
 	}
 	
-void ADS1115_set_comparator_mode(enum COMPARATOR_MODE_MASK mode) {
-	puts("ADS1115_set_comparator_mode");
-	ui8_config_register_comparator_mode_mask = mode;
-	printf("comparator mode mask set to: %d\n", ui8_config_register_comparator_mode_mask);
-	ui8_continuous_configured = 0;
+void ADS1115_set_comparator_mode(ads1115_dev *dev, enum COMPARATOR_MODE_MASK mode) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_set_comparator_mode");
+	dev->ui8_config_register_comparator_mode_mask = mode;
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "comparator mode mask set to: %d", dev->ui8_config_register_comparator_mode_mask);
+	dev->ui8_continuous_configured = 0;
 	}
 	
-void ADS1115_set_comparator_polarity(enum COMPARATOR_POLARITY_MASK polarity) {
-	puts("ADS1115_set_comparator_polarity");
-	ui8_config_register_comparator_polarity_mask = polarity;
-	printf("comparator polarity mask set to: %d\n", ui8_config_register_comparator_polarity_mask);
-	ui8_continuous_configured = 0;
+void ADS1115_set_comparator_polarity(ads1115_dev *dev, enum COMPARATOR_POLARITY_MASK polarity) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_set_comparator_polarity");
+	dev->ui8_config_register_comparator_polarity_mask = polarity;
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "comparator polarity mask set to: %d", dev->ui8_config_register_comparator_polarity_mask);
+	dev->ui8_continuous_configured = 0;
 	}
 	
-void ADS1115_set_comparator_latch(enum COMPARATOR_LATCH_MASK latch) {
-	puts("ADS1115_set_comparator_latch");
-	ui8_config_register_comparator_latch_mask = latch;
-	printf("comparator latch mask set to: %d\n", ui8_config_register_comparator_latch_mask);
-	ui8_continuous_configured = 0;
+void ADS1115_set_comparator_latch(ads1115_dev *dev, enum COMPARATOR_LATCH_MASK latch) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_set_comparator_latch");
+	dev->ui8_config_register_comparator_latch_mask = latch;
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "comparator latch mask set to: %d", dev->ui8_config_register_comparator_latch_mask);
+	dev->ui8_continuous_configured = 0;
 	}
-void ADS1115_set_comparator_queue(enum COMPARATOR_QUEUE_MASK queue) {
-	puts("ADS1115_set_comparator_queue");
-	ui8_config_register_comparator_queue_mask = queue;
-	printf("comparator queue mask set to: %d\n", ui8_config_register_comparator_queue_mask);
-	ui8_continuous_configured = 0;
+void ADS1115_set_comparator_queue(ads1115_dev *dev, enum COMPARATOR_QUEUE_MASK queue) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_set_comparator_queue");
+	dev->ui8_config_register_comparator_queue_mask = queue;
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "comparator queue mask set to: %d", dev->ui8_config_register_comparator_queue_mask);
+	dev->ui8_continuous_configured = 0;
 	}
 	
-void ADS1115_set_pga(enum PGA_MASK pga) {
-	puts("ADS1115_set_pga");
-	float f_temp_range;
+double ADS1115_get_pga_range(enum PGA_MASK pga) {
+	double d_temp_range;
 	
 	switch(pga) {
 		case PGA_6_144:
-			f_temp_range = PGA_6_144V;			
+			d_temp_range = PGA_6_144V;			
 			break;
 		case PGA_4_096:
-			f_temp_range = PGA_4_096V;			
+			d_temp_range = PGA_4_096V;			
 			break;
 		case PGA_2_048:
-			f_temp_range = PGA_2_048V;			
+			d_temp_range = PGA_2_048V;			
 			break;
 		case PGA_1_024:
-			f_temp_range = PGA_1_024V;			
+			d_temp_range = PGA_1_024V;			
 			break;
 		case PGA_0_512:
-			f_temp_range = PGA_0_512V;			
+			d_temp_range = PGA_0_512V;			
 			break;
 		case PGA_0_256:
-			f_temp_range = PGA_0_256V;			
+			d_temp_range = PGA_0_256V;			
 			break;
 		default:
-			f_temp_range = PGA_4_096V;			
+			d_temp_range = PGA_4_096V;			
 			break;
 			}
-			
-	f_resolution = (f_temp_range / 32768.0);
-	ui8_config_register_pga_mask = pga;
-	printf("pga mask set to: %d\n", ui8_config_register_pga_mask);
-	ui8_continuous_configured = 0;
+	return d_temp_range;
+	}
+	
+float ADS1115_get_pga_resolution(enum PGA_MASK pga) {
+	return (ADS1115_get_pga_range(pga) / 32768.0);
+	}
+	
+void ADS1115_codes_to_volts(const int16_t *i16arr_codes, float *farr_volts, int count, enum PGA_MASK pga) {
+	const float f_scale = ADS1115_get_pga_range(pga) / 32768.0;
+	int c = 0;
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+	float32x4_t v_scale = vdupq_n_f32(f_scale);
+	for (; c + 8 <= count; c += 8) {
+		int16x8_t v_codes = vld1q_s16(&i16arr_codes[c]);
+		float32x4_t v_low = vcvtq_f32_s32(vmovl_s16(vget_low_s16(v_codes)));
+		float32x4_t v_high = vcvtq_f32_s32(vmovl_s16(vget_high_s16(v_codes)));
+		vst1q_f32(&farr_volts[c], vmulq_f32(v_low, v_scale));
+		vst1q_f32(&farr_volts[c + 4], vmulq_f32(v_high, v_scale));
+		}
+#elif defined(__AVX2__)
+	__m256 v_scale = _mm256_set1_ps(f_scale);
+	for (; c + 8 <= count; c += 8) {
+		__m128i v_codes = _mm_loadu_si128((const __m128i *)&i16arr_codes[c]);
+		__m256 v_volts = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(v_codes));
+		_mm256_storeu_ps(&farr_volts[c], _mm256_mul_ps(v_volts, v_scale));
+		}
+#elif defined(__SSE2__)
+	__m128 v_scale = _mm_set1_ps(f_scale);
+	for (; c + 8 <= count; c += 8) {
+		__m128i v_codes = _mm_loadu_si128((const __m128i *)&i16arr_codes[c]);
+		// sign extend by unpacking each code into the high half, then shifting down
+		__m128i v_low = _mm_srai_epi32(_mm_unpacklo_epi16(v_codes, v_codes), 16);
+		__m128i v_high = _mm_srai_epi32(_mm_unpackhi_epi16(v_codes, v_codes), 16);
+		_mm_storeu_ps(&farr_volts[c], _mm_mul_ps(_mm_cvtepi32_ps(v_low), v_scale));
+		_mm_storeu_ps(&farr_volts[c + 4], _mm_mul_ps(_mm_cvtepi32_ps(v_high), v_scale));
+		}
+#endif
+	for (; c < count; c++) {
+		farr_volts[c] = i16arr_codes[c] * f_scale;
+		}
+	}
+	
+void ADS1115_codes_to_volts_double(const int16_t *i16arr_codes, double *darr_volts, int count, enum PGA_MASK pga) {
+	const double d_scale = ADS1115_get_pga_range(pga) / 32768.0;
+	int c = 0;
+#if defined(__AVX2__)
+	__m256d v_scale = _mm256_set1_pd(d_scale);
+	for (; c + 4 <= count; c += 4) {
+		__m128i v_codes = _mm_loadl_epi64((const __m128i *)&i16arr_codes[c]);
+		__m256d v_volts = _mm256_cvtepi32_pd(_mm_cvtepi16_epi32(v_codes));
+		_mm256_storeu_pd(&darr_volts[c], _mm256_mul_pd(v_volts, v_scale));
+		}
+#elif defined(__SSE2__)
+	__m128d v_scale = _mm_set1_pd(d_scale);
+	for (; c + 4 <= count; c += 4) {
+		__m128i v_codes = _mm_loadl_epi64((const __m128i *)&i16arr_codes[c]);
+		__m128i v_wide = _mm_srai_epi32(_mm_unpacklo_epi16(v_codes, v_codes), 16);
+		_mm_storeu_pd(&darr_volts[c], _mm_mul_pd(_mm_cvtepi32_pd(v_wide), v_scale));
+		_mm_storeu_pd(&darr_volts[c + 2], _mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(v_wide, 8)), v_scale));
+		}
+#endif
+	// NEON on the Pi has no double lanes, the scalar loop is left to the compiler
+	for (; c < count; c++) {
+		darr_volts[c] = i16arr_codes[c] * d_scale;
+		}
+	}
+	
+void ADS1115_set_pga(ads1115_dev *dev, enum PGA_MASK pga) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_set_pga");
+	dev->f_resolution = ADS1115_get_pga_resolution(pga);
+	dev->ui8_config_register_pga_mask = pga;
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "pga mask set to: %d", dev->ui8_config_register_pga_mask);
+	dev->ui8_continuous_configured = 0;
+	}
+	
+void ADS1115_set_config_word(ads1115_dev *dev, uint16_t ui16_config) {
+	// every config mask at once from a register value, the OS bit is ignored
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_set_config_word");
+	uint8_t ui8_msb = ui16_config >> 8;
+	uint8_t ui8_lsb = ui16_config & 0xFF;
+	dev->ui8_config_register_mult_mask = ui8_msb & 0b01110000;
+	dev->ui8_config_register_pga_mask = ui8_msb & 0b00001110;
+	if (dev->ui8_config_register_pga_mask > PGA_0_256) {
+		dev->ui8_config_register_pga_mask = PGA_0_256; // 110 and 111 are 0.256 V as well
+		}
+	dev->ui8_config_register_conversion_mode_mask = ui8_msb & 0b00000001;
+	dev->ui8_config_register_conversion_rate_mask = ui8_lsb & 0b11100000;
+	dev->ui8_config_register_comparator_mode_mask = ui8_lsb & 0b00010000;
+	dev->ui8_config_register_comparator_polarity_mask = ui8_lsb & 0b00001000;
+	dev->ui8_config_register_comparator_latch_mask = ui8_lsb & 0b00000100;
+	dev->ui8_config_register_comparator_queue_mask = ui8_lsb & 0b00000011;
+	dev->f_resolution = ADS1115_get_pga_resolution(dev->ui8_config_register_pga_mask);
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "config word set to: 0x%04x", ui16_config);
+	dev->ui8_continuous_configured = 0;
+	}
+	
+void ADS1115_invalidate_shadow(ads1115_dev *dev) {
+	// after a failed transfer the chip state is unknown, rewrite everything
+	dev->ui8_pointer_shadow = ADS1115_SHADOW_UNKNOWN;
+	dev->ui8_register_shadow_valid = 0;
+	}
+	
+int ADS1115_queue_pointer(ads1115_dev *dev, struct i2c_msg *msgs, int i_count, uint8_t ui8_register) {
+	// the pointer byte is only sent when the chip is not already there
+	if (dev->ui8_pointer_shadow != ui8_register) {
+		struct i2c_msg msg = {dev->ui8_address, 0, 1, &ui8arr_pointer_values[ui8_register]};
+		msgs[i_count++] = msg;
+		dev->ui8_pointer_shadow = ui8_register;
+		}
+	return i_count;
+	}
+	
+int ADS1115_queue_read(ads1115_dev *dev, struct i2c_msg *msgs, int i_count, uint8_t ui8_register, uint8_t *ui8arr_buffer) {
+	i_count = ADS1115_queue_pointer(dev, msgs, i_count, ui8_register);
+	struct i2c_msg msg = {dev->ui8_address, I2C_M_RD, 2, ui8arr_buffer};
+	msgs[i_count++] = msg;
+	return i_count;
+	}
+	
+int ADS1115_queue_write(ads1115_dev *dev, struct i2c_msg *msgs, int i_count, uint8_t *ui8arr_buffer, uint8_t ui8_force) {
+	// ui8arr_buffer holds pointer, msb, lsb -- skip the write when the
+	// register already holds the value, unless the write itself is the
+	// point (e.g. the OS bit starting a single shot conversion)
+	uint8_t ui8_register = ui8arr_buffer[0];
+	uint16_t ui16_value = ui8arr_buffer[1] << 8 | ui8arr_buffer[2];
+	if (ui8_register == POINTER_REGISTER_CONFIG) {
+		ui16_value &= ~(CONFIG_REGISTER_START_CONVERSION << 8); // OS reads back as status
+		}
+	if (!ui8_force && (dev->ui8_register_shadow_valid & (1 << ui8_register)) &&
+		dev->ui16arr_register_shadow[ui8_register] == ui16_value) {
+		return i_count;
+		}
+	struct i2c_msg msg = {dev->ui8_address, 0, 3, ui8arr_buffer};
+	msgs[i_count++] = msg;
+	dev->ui16arr_register_shadow[ui8_register] = ui16_value;
+	dev->ui8_register_shadow_valid |= (1 << ui8_register);
+	dev->ui8_pointer_shadow = ui8_register;
+	return i_count;
 	}
 	
-void ADS1115_build_config_register(uint8_t ui8_conversion_mode) {
+int ADS1115_transfer(ads1115_dev *dev, struct i2c_msg *msgs, int count) {
+	if (count == 0) {
+		return ADS1115_OK;
+		}
+	uint32_t ui32_bytes = 0;
+	for (int c = 0; c < count; c++) {
+		ui32_bytes += msgs[c].len;
+		}
+	ADS1115_STAT_ADD(dev, ui64_transfers, 1);
+	ADS1115_STAT_ADD(dev, ui64_messages, count);
+	ADS1115_STAT_ADD(dev, ui64_bytes, ui32_bytes);
+	if (dev->transport.transfer(dev->transport.context, msgs, count) != ADS1115_OK) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_transfer: %s", strerror(errno));
+		ADS1115_STAT_ADD(dev, ui64_errors, 1);
+		ADS1115_invalidate_shadow(dev);
+		return ADS1115_ERROR_IO;
+		}
+	return ADS1115_OK;
+	}
+	
+int ADS1115_read_register(ads1115_dev *dev, uint8_t ui8_register, uint8_t *ui8arr_buffer) {
+	// pointer (when needed) + read 2 bytes as a single transaction
+	struct i2c_msg msgs[2];
+	int i_count = ADS1115_queue_read(dev, msgs, 0, ui8_register, ui8arr_buffer);
+	return ADS1115_transfer(dev, msgs, i_count);
+	}
+	
+int ADS1115_write_register(ads1115_dev *dev, uint8_t *ui8arr_buffer, uint8_t ui8_force) {
+	struct i2c_msg msgs[1];
+	int i_count = ADS1115_queue_write(dev, msgs, 0, ui8arr_buffer, ui8_force);
+	return ADS1115_transfer(dev, msgs, i_count);
+	}
+	
+int16_t ADS1115_volts_to_code(ads1115_dev *dev, double d_volts) {
+	// nearest code at the current PGA, clamped to the register range
+	double d_code = d_volts / dev->f_resolution;
+	if (d_code >= 32767.0) {
+		return INT16_MAX;
+		}
+	if (d_code <= -32768.0) {
+		return INT16_MIN;
+		}
+	return (int16_t)(d_code + ((d_code < 0) ? -0.5 : 0.5));
+	}
+	
+int ADS1115_queue_thresholds(ads1115_dev *dev, struct i2c_msg *msgs, int i_count, int16_t i16_low, int16_t i16_high) {
+	// both registers, a register already holding its value is skipped
+	uint8_t *ui8arr_low = dev->ui8arr_threshold_buffer[0];
+	uint8_t *ui8arr_high = dev->ui8arr_threshold_buffer[1];
+	ui8arr_low[0] = POINTER_REGISTER_LOW_THRESHOLD;
+	ui8arr_low[1] = (uint16_t)i16_low >> 8;
+	ui8arr_low[2] = (uint16_t)i16_low & 0xFF;
+	ui8arr_high[0] = POINTER_REGISTER_HIGH_THRESHOLD;
+	ui8arr_high[1] = (uint16_t)i16_high >> 8;
+	ui8arr_high[2] = (uint16_t)i16_high & 0xFF;
+	i_count = ADS1115_queue_write(dev, msgs, i_count, ui8arr_low, 0);
+	return ADS1115_queue_write(dev, msgs, i_count, ui8arr_high, 0);
+	}
+	
+int ADS1115_queue_volt_thresholds(ads1115_dev *dev, struct i2c_msg *msgs, int i_count) {
+	// thresholds set in volts at the PGA about to convert, nothing goes out
+	// unless the PGA changed since they were last written. Ready mode holds
+	// the registers until it ends.
+	if (!dev->ui8_thresholds_volts || dev->ui8_ready_mode) {
+		return i_count;
+		}
+	return ADS1115_queue_thresholds(dev, msgs, i_count, ADS1115_volts_to_code(dev, dev->d_threshold_low_volts), ADS1115_volts_to_code(dev, dev->d_threshold_high_volts));
+	}
+	
+int ADS1115_write_thresholds(ads1115_dev *dev, int16_t i16_low, int16_t i16_high) {
+	// both registers in one transaction
+	struct i2c_msg msgs[2];
+	int i_count = ADS1115_queue_thresholds(dev, msgs, 0, i16_low, i16_high);
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "thresholds set to: %d, %d", i16_low, i16_high);
+	int i_status = ADS1115_transfer(dev, msgs, i_count);
+	if (i_status == ADS1115_OK) {
+		dev->i16_threshold_low = i16_low;
+		dev->i16_threshold_high = i16_high;
+		}
+	return i_status;
+	}
+	
+int ADS1115_set_pointer_register(ads1115_dev *dev, enum POINTER_MASK mode) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_set_pointer_register");
+	// aims the chip's pointer now, nothing goes out if it is already there.
+	// Later reads and writes move it again to the register they need.
+	struct i2c_msg msgs[1];
+	int i_count = ADS1115_queue_pointer(dev, msgs, 0, mode);
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "pointer register set to: %d", mode);
+	return ADS1115_transfer(dev, msgs, i_count);
+	}
+	
+void ADS1115_build_config_register(ads1115_dev *dev, uint8_t ui8_conversion_mode) {
 	// set pointer register to config mode
-	ui8arr_write_buffer[0] = POINTER_REGISTER_CONFIG;
+	dev->ui8arr_write_buffer[0] = POINTER_REGISTER_CONFIG;
 	
 	// clear previous register masks 
-	ui8arr_write_buffer[1] = 0; // clear bits 15-8
-	ui8arr_write_buffer[2] = 0; // clear bits 7-0	
+	dev->ui8arr_write_buffer[1] = 0; // clear bits 15-8
+	dev->ui8arr_write_buffer[2] = 0; // clear bits 7-0	
 	
 	// apply config register masks
-	ui8arr_write_buffer[1] |= ui8_config_register_operation_mask; // bit 15
-	ui8arr_write_buffer[1] |= ui8_config_register_mult_mask; // bit 14-12
-	ui8arr_write_buffer[1] |= ui8_config_register_pga_mask; // bit 11-9
-	ui8arr_write_buffer[1] |= ui8_conversion_mode; // bit 8
-	ui8arr_write_buffer[2] |= ui8_config_register_conversion_rate_mask; // bit 7-5
-	ui8arr_write_buffer[2] |= ui8_config_register_comparator_mode_mask; // bit 4
-	ui8arr_write_buffer[2] |= ui8_config_register_comparator_polarity_mask; // bit 3
-	ui8arr_write_buffer[2] |= ui8_config_register_comparator_latch_mask; // bit 2
-	ui8arr_write_buffer[2] |= ui8_config_register_comparator_queue_mask; // bit 1-0	
-	}
-	
-double ADS1115_convert_read_buffer() {
-	// stream conversion into a 16 bit field
-	uint16_t ui16_temp_read_buffer = ui8arr_read_buffer[0] << 8 | ui8arr_read_buffer[1]; 
-	
-	// handle sign
-	int i_temp_sign = 1;
-	if (ui16_temp_read_buffer > 32768) {
-		ui16_temp_read_buffer = (~ui16_temp_read_buffer + 1); // two's compliment
-		i_temp_sign = -1;
-		}
+	dev->ui8arr_write_buffer[1] |= dev->ui8_config_register_operation_mask; // bit 15
+	dev->ui8arr_write_buffer[1] |= dev->ui8_config_register_mult_mask; // bit 14-12
+	dev->ui8arr_write_buffer[1] |= dev->ui8_config_register_pga_mask; // bit 11-9
+	dev->ui8arr_write_buffer[1] |= ui8_conversion_mode; // bit 8
+	dev->ui8arr_write_buffer[2] |= dev->ui8_config_register_conversion_rate_mask; // bit 7-5
+	dev->ui8arr_write_buffer[2] |= dev->ui8_config_register_comparator_mode_mask; // bit 4
+	dev->ui8arr_write_buffer[2] |= dev->ui8_config_register_comparator_polarity_mask; // bit 3
+	dev->ui8arr_write_buffer[2] |= dev->ui8_config_register_comparator_latch_mask; // bit 2
+	dev->ui8arr_write_buffer[2] |= dev->ui8_config_register_comparator_queue_mask; // bit 1-0	
+	}
+	
+int16_t ADS1115_get_code(const uint8_t *ui8arr_buffer) {
+	// conversion register is big endian two's complement, 0x8000 is -32768
+	return (int16_t)(ui8arr_buffer[0] << 8 | ui8arr_buffer[1]);
+	}
+	
+double ADS1115_convert_read_buffer(ads1115_dev *dev, float f_resolution) {
 	// convert to volts
-	return (ui16_temp_read_buffer * f_resolution * i_temp_sign);
+	return (ADS1115_get_code(dev->ui8arr_read_buffer) * (double)f_resolution);
 	}
 	
-long ADS1115_get_conversion_period_ns() {
-	return 1000000000L / iarr_conversion_rate_sps[ui8_config_register_conversion_rate_mask >> 5];
+long ADS1115_get_rate_period_ns(uint8_t ui8_rate_mask) {
+	return 1000000000L / iarr_conversion_rate_sps[ui8_rate_mask >> 5];
 	}
 	
-double ADS1115_get_single_conversion() {	
-	//puts("ADS1115_get_single_conversion");
+long ADS1115_get_conversion_period_ns(ads1115_dev *dev) {
+	return ADS1115_get_rate_period_ns(dev->ui8_config_register_conversion_rate_mask);
+	}
+	
+double ADS1115_drift_ratio(ads1115_dev *dev, uint8_t ui8_rate_mask) {
+	// a rate not measured yet runs off the same oscillator as the ones that were
+	double d_ratio = dev->darr_clock_ratio[ui8_rate_mask >> 5];
+	return (d_ratio > 0) ? d_ratio : dev->d_clock_ratio;
+	}
+	
+double ADS1115_get_clock_ratio(ads1115_dev *dev) {
+	return ADS1115_drift_ratio(dev, dev->ui8_config_register_conversion_rate_mask);
+	}
+	
+long ADS1115_get_sample_period_ns(ads1115_dev *dev) {
+	// the period the chip really converts at, as far as it has been learned, but
+	// never shorter than the datasheet allows -- a continuous read ahead of the
+	// conversion returns the last sample again
+	double d_ratio = ADS1115_get_clock_ratio(dev);
+	double d_floor = 1 - ADS1115_OSCILLATOR_TOLERANCE_PERCENT / 100.0;
+	return (long)(ADS1115_get_conversion_period_ns(dev) * ((d_ratio < d_floor) ? d_floor : d_ratio));
+	}
+	
+int ADS1115_drift_measured(ads1115_dev *dev) {
+	// the current rate learned on its own, or from single shot pairs for all rates
+	return (dev->darr_clock_ratio[dev->ui8_config_register_conversion_rate_mask >> 5] > 0 || dev->ui16_drift_pairs > 0);
+	}
+	
+long ADS1115_drift_pace_ns(ads1115_dev *dev) {
+	// continuous reads one period apart. Until the clock has been measured the
+	// chip may be as slow as the datasheet allows, pace at that -- a read ahead
+	// of the conversion returns the last sample again, one behind only passes
+	// over a conversion
+	if (ADS1115_drift_measured(dev)) {
+		return ADS1115_get_sample_period_ns(dev);
+		}
+	return (long)(ADS1115_get_conversion_period_ns(dev) * (1 + ADS1115_OSCILLATOR_TOLERANCE_PERCENT / 100.0));
+	}
+	
+void ADS1115_drift_set(ads1115_dev *dev, uint8_t ui8_rate_mask, double d_ratio) {
+	// a stalled bus or a stray edge must not drag the estimate far past the datasheet
+	double d_limit = 2 * ADS1115_OSCILLATOR_TOLERANCE_PERCENT / 100.0;
+	if (d_ratio < 1 - d_limit) {
+		d_ratio = 1 - d_limit;
+		}
+	if (d_ratio > 1 + d_limit) {
+		d_ratio = 1 + d_limit;
+		}
+	dev->darr_clock_ratio[ui8_rate_mask >> 5] = d_ratio;
+	}
+	
+long ADS1115_drift_single_ns(ads1115_dev *dev, uint8_t ui8_rate_mask) {
+	// config write to result of a single shot, as measured, else the learned period
+	int i_rate = ui8_rate_mask >> 5;
+	if (dev->larr_single_ns[i_rate] > 0) {
+		return dev->larr_single_ns[i_rate];
+		}
+	return (long)(ADS1115_get_rate_period_ns(ui8_rate_mask) * ADS1115_drift_ratio(dev, ui8_rate_mask));
+	}
+	
+long ADS1115_drift_first_poll_ns(ads1115_dev *dev, uint8_t ui8_rate_mask) {
+	// from the start of a conversion to its first "done" poll
+	return (long)(ADS1115_drift_single_ns(dev, ui8_rate_mask) * (1 + dev->darr_poll_margin[ui8_rate_mask >> 5]));
+	}
+	
+uint64_t ADS1115_drift_done(ads1115_dev *dev, uint8_t ui8_rate_mask, uint64_t ui64_start, uint64_t ui64_seen, int i_first_poll) {
+	// seen done at ui64_seen, returns the time the conversion is estimated to have finished
+	double *dp_margin = &dev->darr_poll_margin[ui8_rate_mask >> 5];
+	if (i_first_poll && *dp_margin > -ADS1115_OSCILLATOR_TOLERANCE_PERCENT / 100.0) {
+		*dp_margin -= ADS1115_DRIFT_STEP_PPM / 1000000.0;
+		}
+	uint64_t ui64_ready = ui64_start + ADS1115_drift_single_ns(dev, ui8_rate_mask);
+	return (ui64_ready < ui64_seen) ? ui64_ready : ui64_seen;
+	}
+	
+double ADS1115_drift_blend(double d_learned, double d_measured, uint16_t ui16_count) {
+	// running mean over the first ADS1115_DRIFT_EDGE_WEIGHT measurements, a
+	// low-pass of that weight after
+	double d_weight = (ui16_count < ADS1115_DRIFT_EDGE_WEIGHT) ? ui16_count : ADS1115_DRIFT_EDGE_WEIGHT;
+	return d_learned + (d_measured - d_learned) / d_weight;
+	}
+	
+void ADS1115_drift_single(ads1115_dev *dev, uint8_t ui8_rate_mask, uint64_t ui64_latency_ns) {
+	// one single shot timed from config write to result. Bus time and wake-up
+	// ride along, so the clock ratio comes from the difference to the rate
+	// measured furthest away, where they cancel.
+	int i_rate = ui8_rate_mask >> 5;
+	long l_period_ns = ADS1115_get_rate_period_ns(ui8_rate_mask);
+	long l_latency_ns = (long)ui64_latency_ns;
+	long *lp_learned_ns = &dev->larr_single_ns[i_rate];
+	if (*lp_learned_ns > 0 && labs(l_latency_ns - *lp_learned_ns) > ADS1115_DRIFT_OUTLIER_NS) {
+		// a late wake-up, unless it keeps happening -- then the learned one was
+		if (++dev->ui8arr_single_outliers[i_rate] < ADS1115_DRIFT_OUTLIER_RUN) {
+			return;
+			}
+		dev->ui16arr_single_count[i_rate] = 0;
+		}
+	dev->ui8arr_single_outliers[i_rate] = 0;
+	if (dev->ui16arr_single_count[i_rate] < UINT16_MAX) {
+		dev->ui16arr_single_count[i_rate]++;
+		}
+	*lp_learned_ns = (dev->ui16arr_single_count[i_rate] == 1) ? l_latency_ns
+		: (long)ADS1115_drift_blend(*lp_learned_ns, l_latency_ns, dev->ui16arr_single_count[i_rate]);
+	int i_other = -1;
+	long l_span_ns = 0;
+	for (int r = 0; r < 8; r++) {
+		long l_gap_ns = labs(ADS1115_get_rate_period_ns(r << 5) - l_period_ns);
+		if (dev->larr_single_ns[r] > 0 && l_gap_ns > l_span_ns) {
+			i_other = r;
+			l_span_ns = l_gap_ns;
+			}
+		}
+	if (l_span_ns < ADS1115_DRIFT_SPAN_NS) {
+		return;
+		}
+	// this shot against what the other rate has learned, into the running estimate
+	double d_pair = (double)(l_latency_ns - dev->larr_single_ns[i_other])
+		/ (l_period_ns - ADS1115_get_rate_period_ns(i_other << 5));
+	if (dev->ui16_drift_pairs < UINT16_MAX) {
+		dev->ui16_drift_pairs++;
+		}
+	double d_ratio = ADS1115_drift_blend(dev->d_clock_ratio, d_pair, dev->ui16_drift_pairs);
+	ADS1115_drift_set(dev, ui8_rate_mask, d_ratio);
+	ADS1115_drift_set(dev, i_other << 5, d_ratio);
+	dev->d_clock_ratio = dev->darr_clock_ratio[i_rate];
+	}
+	
+void ADS1115_drift_busy(ads1115_dev *dev, uint8_t ui8_rate_mask, uint64_t ui64_start, uint64_t ui64_seen) {
+	// still converting at ui64_seen -- the first poll only finds a conversion
+	// running once it has crept up to the end, so this is the latency
+	ADS1115_drift_single(dev, ui8_rate_mask, ui64_seen - ui64_start);
+	dev->darr_poll_margin[ui8_rate_mask >> 5] = ADS1115_DRIFT_MARGIN_PERCENT / 100.0;
+	}
+	
+void ADS1115_drift_edge(ads1115_dev *dev, uint8_t ui8_rate_mask, uint64_t ui64_interval_ns) {
+	// one period measured between two ALERT/RDY edges of a continuous stream
+	double d_ratio = (double)ui64_interval_ns / ADS1115_get_rate_period_ns(ui8_rate_mask);
+	double d_learned = ADS1115_drift_ratio(dev, ui8_rate_mask);
+	ADS1115_drift_set(dev, ui8_rate_mask, d_learned + (d_ratio - d_learned) / ADS1115_DRIFT_EDGE_WEIGHT);
+	}
+	
+void ADS1115_timespec_add_ns(struct timespec *ts, int64_t i64_ns) {
+	// 64 bit throughout, long is 32 bits on ARM and overflows past ~2.1 s
+	int64_t i64_nsec = ts->tv_nsec + i64_ns;
+	ts->tv_sec += i64_nsec / 1000000000LL;
+	ts->tv_nsec = i64_nsec % 1000000000LL;
+	}
+	
+int ADS1115_timespec_after(const struct timespec *a, const struct timespec *b) {
+	return (a->tv_sec > b->tv_sec || (a->tv_sec == b->tv_sec && a->tv_nsec > b->tv_nsec));
+	}
+	
+uint64_t ADS1115_timespec_to_ns(const struct timespec *ts) {
+	return (uint64_t)ts->tv_sec * 1000000000ULL + ts->tv_nsec;
+	}
+	
+uint64_t ADS1115_get_timestamp_ns() {
+	struct timespec ts_now;
+	clock_gettime(CLOCK_MONOTONIC, &ts_now);
+	return ADS1115_timespec_to_ns(&ts_now);
+	}
+	
+void ADS1115_set_timeout(ads1115_dev *dev, int ms) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_set_timeout");
+	if (ms < 1) {
+		ms = ADS1115_DEFAULT_TIMEOUT_MS;
+		}
+	dev->i_timeout_ms = ms;
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "conversion timeout set to: %d ms", dev->i_timeout_ms);
+	}
+	
+void ADS1115_set_autorange(ads1115_dev *dev, int i_enable) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_set_autorange");
+	// the current PGA is the starting range
+	dev->ui8_autorange = (i_enable != 0);
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "autorange set to: %d", dev->ui8_autorange);
+	}
+	
+uint8_t ADS1115_autorange_select(uint8_t ui8_pga_mask, int16_t i16_code) {
+	// a clipped code could be any value beyond full scale, start over from the widest range
+	if (i16_code == INT16_MAX || i16_code == INT16_MIN) {
+		return PGA_6_144;
+		}
+	int i_magnitude = abs(i16_code);
+	double d_range = ADS1115_get_pga_range(ui8_pga_mask);
+	double d_volts = i_magnitude * d_range / 32768.0;
+	
+	// narrowest range that keeps the value under the low mark
+	uint8_t ui8_best = PGA_6_144;
+	for (int c = 0; c < 6; c++) {
+		if (d_volts * 100 < ADS1115_get_pga_range(ui8arr_autorange_order[c]) * ADS1115_AUTORANGE_LOW_PERCENT) {
+			ui8_best = ui8arr_autorange_order[c];
+			break;
+			}
+		}
+	
+	// widen near full scale, narrow only when the value fits well below it
+	if (i_magnitude * 100 >= 32768 * ADS1115_AUTORANGE_HIGH_PERCENT) {
+		return ui8_best;
+		}
+	if (ADS1115_get_pga_range(ui8_best) < d_range) {
+		return ui8_best;
+		}
+	return ui8_pga_mask;
+	}
+	
+int ADS1115_autorange_update(ads1115_dev *dev, int16_t i16_code) {
+	// apply the range the code asks for, returns 1 when the code must be discarded
+	uint8_t ui8_pga_mask = ADS1115_autorange_select(dev->ui8_config_register_pga_mask, i16_code);
+	if (ui8_pga_mask == dev->ui8_config_register_pga_mask) {
+		return 0;
+		}
+	ADS1115_TRACE(ADS1115_TRACE_DEBUG, "autorange pga %d -> %d (code %d)", dev->ui8_config_register_pga_mask, ui8_pga_mask, i16_code);
+	dev->ui8_config_register_pga_mask = ui8_pga_mask;
+	dev->f_resolution = ADS1115_get_pga_resolution(ui8_pga_mask);
+	dev->ui8_continuous_configured = 0;
+	return (i16_code == INT16_MAX || i16_code == INT16_MIN);
+	}
+	
+void ADS1115_set_adaptive_rate(ads1115_dev *dev, int i_enable) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_set_adaptive_rate");
+	// the current rates are the starting rates, every channel starts over
+	dev->ui8_adaptive_rate = (i_enable != 0);
+	dev->adaptive.ui8_valid = 0;
+	for (int c = 0; c < dev->i_scan_count; c++) {
+		dev->scan_list[c].adaptive.ui8_valid = 0;
+		}
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "adaptive rate set to: %d", dev->ui8_adaptive_rate);
+	}
+	
+int ADS1115_set_adaptive_thresholds(ads1115_dev *dev, enum RATE_MASK slowest, enum RATE_MASK fastest, int16_t i16_quiet_codes, int16_t i16_busy_codes) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_set_adaptive_thresholds");
+	// closer thresholds would let a steady slope bounce between two rates
+	if (slowest > fastest || i16_quiet_codes < 0 || i16_busy_codes < 2 * i16_quiet_codes) {
+		ADS1115_TRACE(ADS1115_TRACE_WARNING, "ADS1115_set_adaptive_thresholds - invalid thresholds");
+		return ADS1115_ERROR_INVALID;
+		}
+	dev->ui8_adaptive_slowest = slowest;
+	dev->ui8_adaptive_fastest = fastest;
+	dev->i16_adaptive_quiet = i16_quiet_codes;
+	dev->i16_adaptive_busy = i16_busy_codes;
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "adaptive thresholds set to: %d %d %d %d", slowest, fastest, i16_quiet_codes, i16_busy_codes);
+	return ADS1115_OK;
+	}
+	
+uint8_t ADS1115_adaptive_select(ads1115_dev *dev, ads1115_adaptive_state *state, uint8_t ui8_rate_mask, uint8_t ui8_pga_mask, int16_t i16_code) {
+	// rate for the next conversion of a channel whose last code converted at ui8_rate_mask
+	if (ui8_rate_mask < dev->ui8_adaptive_slowest) {
+		ui8_rate_mask = dev->ui8_adaptive_slowest;
+		}
+	if (ui8_rate_mask > dev->ui8_adaptive_fastest) {
+		ui8_rate_mask = dev->ui8_adaptive_fastest;
+		}
+	
+	// the first code, or one at another range, only sets the reference
+	int i_compare = (state->ui8_valid && state->ui8_last_pga_mask == ui8_pga_mask);
+	int i_change = abs((int)i16_code - state->i16_last_code);
+	state->i16_last_code = i16_code;
+	state->ui8_last_pga_mask = ui8_pga_mask;
+	state->ui8_valid = 1;
+	if (!i_compare) {
+		state->ui8_quiet_count = 0;
+		return ui8_rate_mask;
+		}
+	
+	if (i_change >= dev->i16_adaptive_busy) {
+		state->ui8_quiet_count = 0;
+		return dev->ui8_adaptive_fastest;
+		}
+	if (i_change >= dev->i16_adaptive_quiet) {
+		state->ui8_quiet_count = 0;
+		return ui8_rate_mask;
+		}
+	if (++state->ui8_quiet_count < ADS1115_ADAPTIVE_QUIET_SAMPLES) {
+		return ui8_rate_mask;
+		}
+	state->ui8_quiet_count = 0;
+	return (ui8_rate_mask > dev->ui8_adaptive_slowest) ? (uint8_t)(((ui8_rate_mask >> 5) - 1) << 5) : ui8_rate_mask;
+	}
+	
+int ADS1115_adaptive_update(ads1115_dev *dev, uint8_t ui8_pga_mask, int16_t i16_code) {
+	// apply the rate the single channel setup asks for, returns 1 when it changed
+	uint8_t ui8_rate_mask = ADS1115_adaptive_select(dev, &dev->adaptive, dev->ui8_config_register_conversion_rate_mask, ui8_pga_mask, i16_code);
+	if (ui8_rate_mask == dev->ui8_config_register_conversion_rate_mask) {
+		return 0;
+		}
+	ADS1115_TRACE(ADS1115_TRACE_DEBUG, "adaptive rate %d -> %d (code %d)", dev->ui8_config_register_conversion_rate_mask, ui8_rate_mask, i16_code);
+	dev->ui8_config_register_conversion_rate_mask = ui8_rate_mask;
+	dev->ui8_continuous_configured = 0;
+	return 1;
+	}
+	
+int ADS1115_wait_conversion(ads1115_dev *dev, const struct timespec *ts_start, uint8_t ui8_rate_mask, uint8_t *ui8arr_conversion) {
+	long l_period_ns = ADS1115_get_rate_period_ns(ui8_rate_mask);
+	struct timespec ts_now;
+	struct timespec ts_deadline = *ts_start;
+	ADS1115_timespec_add_ns(&ts_deadline, (int64_t)dev->i_timeout_ms * 1000000);
+	
+	// sleep until just after the learned single shot latency before
+	// touching the bus, or until the deadline if that comes first -- a poll
+	// pulled in that far says nothing about the latency
+	struct timespec ts_wait = *ts_start;
+	ADS1115_timespec_add_ns(&ts_wait, ADS1115_drift_first_poll_ns(dev, ui8_rate_mask));
+	int i_clamped = ADS1115_timespec_after(&ts_wait, &ts_deadline);
+	if (i_clamped) {
+		ts_wait = ts_deadline;
+		}
+	clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts_wait, NULL);
+	uint64_t ui64_start = ADS1115_timespec_to_ns(ts_start);
+	
+	// each poll reads the config register, and when the caller asks for it
+	// the conversion register too, all in one transaction -- a poll that
+	// sees the "done" bit then already carries the result
+	struct i2c_msg msgs[4];
+	
+	// poll the "done" bit at a fraction of the period until the deadline
+	ts_wait.tv_sec = 0;
+	ts_wait.tv_nsec = l_period_ns / ADS1115_POLL_DIVIDER;
+	for (int i_poll = 0; ; i_poll++) {
+		int i_count = ADS1115_queue_read(dev, msgs, 0, POINTER_REGISTER_CONFIG, dev->ui8arr_read_buffer);
+		if (ui8arr_conversion != NULL) {
+			i_count = ADS1115_queue_read(dev, msgs, i_count, POINTER_REGISTER_CONVERSION, ui8arr_conversion);
+			}
+		ADS1115_STAT_ADD(dev, ui64_polls, 1);
+		uint64_t ui64_sent = ADS1115_get_timestamp_ns();
+		if (ADS1115_transfer(dev, msgs, i_count) != ADS1115_OK) {
+			return ADS1115_ERROR_IO;
+			}
+		clock_gettime(CLOCK_MONOTONIC, &ts_now);
+		if (dev->ui8arr_read_buffer[0] & CONFIG_REGISTER_IDLE) {
+			dev->ui64_ready_ns = ADS1115_drift_done(dev, ui8_rate_mask, ui64_start, ADS1115_timespec_to_ns(&ts_now), i_poll == 0);
+			return ADS1115_OK;
+			}
+		if (i_poll == 0 && !i_clamped) {
+			ADS1115_drift_busy(dev, ui8_rate_mask, ui64_start, ui64_sent);
+			}
+		if (ADS1115_timespec_after(&ts_now, &ts_deadline)) {
+			ADS1115_TRACE(ADS1115_TRACE_WARNING, "ADS1115_wait_conversion - timeout");
+			ADS1115_STAT_ADD(dev, ui64_timeouts, 1);
+			return ADS1115_ERROR_TIMEOUT;
+			}
+		nanosleep(&ts_wait, NULL);
+		}
+	}
+	
+int ADS1115_ready_wait_enabled(ads1115_dev *dev) {
+	return (dev->ui8_ready_mode && dev->i_alert_fd >= 0);
+	}
+	
+void ADS1115_drain_alert(ads1115_dev *dev) {
+	// drop edges left over from earlier conversions before starting a new one
+	struct pollfd poll_alert = {dev->i_alert_fd, POLLIN | POLLPRI, 0};
+	struct gpio_v2_line_event events[ADS1115_ALERT_EVENTS];
+	while (poll(&poll_alert, 1, 0) > 0) {
+		if (read(dev->i_alert_fd, events, sizeof(events)) <= 0) {
+			break;
+			}
+		}
+	}
+	
+int ADS1115_start_single_raw(ads1115_dev *dev) {
 	// build config register -- force single conversion
-	ADS1115_build_config_register(CONFIG_REGISTER_SINGLE_CONVERSION);
+	ADS1115_build_config_register(dev, CONFIG_REGISTER_SINGLE_CONVERSION);
 	
 	// a single shot write leaves the chip powered down after the conversion
-	ui8_continuous_configured = 0;
+	dev->ui8_continuous_configured = 0;
 	
-	// clear read buffer
-	ui8arr_read_buffer[0] = 0;
-	ui8arr_read_buffer[1] = 0;
+	if (ADS1115_ready_wait_enabled(dev)) {
+		ADS1115_drain_alert(dev);
+		}
 	
-	// write configure register
-	write(i_ADS1115_handle, ui8arr_write_buffer, 3); 
+	// write configure register -- always, the write is what starts the conversion
+	struct i2c_msg msgs[3];
+	int i_count = ADS1115_queue_volt_thresholds(dev, msgs, 0);
+	i_count = ADS1115_queue_write(dev, msgs, i_count, dev->ui8arr_write_buffer, 1);
+	if (ADS1115_transfer(dev, msgs, i_count) != ADS1115_OK) {
+		return ADS1115_ERROR_IO;
+		}
+	return ADS1115_OK;
+	}
 	
-	// wait for "done" bit to raise
-	// TODO: add handle to prevent infinite loop
-	while((ui8arr_read_buffer[0] & 0x80) == 0 ) { 
-		read(i_ADS1115_handle, ui8arr_read_buffer, 2);
+int ADS1115_poll_single_raw(ads1115_dev *dev, int16_t *i16_code) {
+	// one look at the "done" bit without sleeping, ADS1115_PENDING while converting
+	if (ADS1115_ready_wait_enabled(dev)) {
+		int i_status = ADS1115_wait_alert(dev, 0, i16_code);
+		return (i_status == ADS1115_ERROR_TIMEOUT) ? ADS1115_PENDING : i_status;
 		}
 	
-	// set pointer register to conversion mode
-	ui8arr_write_buffer[0] = 0;
+	// same transaction as a ADS1115_wait_conversion() poll, the result comes along
+	uint8_t ui8arr_conversion[2];
+	struct i2c_msg msgs[4];
+	int i_count = ADS1115_queue_read(dev, msgs, 0, POINTER_REGISTER_CONFIG, dev->ui8arr_read_buffer);
+	i_count = ADS1115_queue_read(dev, msgs, i_count, POINTER_REGISTER_CONVERSION, ui8arr_conversion);
+	ADS1115_STAT_ADD(dev, ui64_polls, 1);
+	if (ADS1115_transfer(dev, msgs, i_count) != ADS1115_OK) {
+		return ADS1115_ERROR_IO;
+		}
+	if (!(dev->ui8arr_read_buffer[0] & CONFIG_REGISTER_IDLE)) {
+		return ADS1115_PENDING;
+		}
+	*i16_code = ADS1115_get_code(ui8arr_conversion);
+	return ADS1115_OK;
+	}
 	
-	// start conversion
-	write(i_ADS1115_handle, ui8arr_write_buffer, 3);
+int ADS1115_get_single_raw(ads1115_dev *dev, int16_t *i16_code) {	
+	if (ADS1115_start_single_raw(dev) != ADS1115_OK) {
+		return ADS1115_ERROR_IO;
+		}
 	
-	// read conversion 
-	read(i_ADS1115_handle, ui8arr_read_buffer, 2); 
+	// the conversion runs from the end of the config write, drift learning and
+	// the latency histogram both time it from there, like the staggered reads
+	struct timespec ts_start;
+	clock_gettime(CLOCK_MONOTONIC, &ts_start);
+	uint64_t ui64_start = ADS1115_timespec_to_ns(&ts_start);
 	
-	double d_temp_conversion = ADS1115_convert_read_buffer();
-	printf("conversion = %1.4f (V)\n", d_temp_conversion);	// Print the result to terminal, first convert from binary value to mV
-	return d_temp_conversion;
-	}
+	// the RDY edge stands in for the config register polls, one read fetches the result
+	if (ADS1115_ready_wait_enabled(dev)) {
+		int i_status = ADS1115_wait_alert(dev, dev->i_timeout_ms, i16_code);
+		if (i_status == ADS1115_ERROR_TIMEOUT) {
+			ADS1115_STAT_ADD(dev, ui64_timeouts, 1);
+			}
+		else if (i_status == ADS1115_OK) {
+			// the edge is stamped when the conversion ended, it times the single shot
+			if (dev->ui64_alert_ns > ui64_start) {
+				ADS1115_drift_single(dev, dev->ui8_config_register_conversion_rate_mask, dev->ui64_alert_ns - ui64_start);
+				}
+			dev->ui64_ready_ns = dev->ui64_alert_ns;
+			ADS1115_record_latency(dev, ADS1115_get_timestamp_ns() - ui64_start);
+			}
+		return i_status;
+		}
 	
-int ADS1115_start_continuous() {
-	// build config register -- continuous conversion
-	ADS1115_build_config_register(CONFIG_REGISTER_CONTINUOUS_CONVERSION);
-	if (write(i_ADS1115_handle, ui8arr_write_buffer, 3) != 3) {
-		perror("ADS1115_start_continuous - write config");
-		return -1;
+	// wait for "done" bit to raise, the final poll also reads the conversion
+	uint8_t ui8arr_conversion[2];
+	int i_status = ADS1115_wait_conversion(dev, &ts_start, dev->ui8_config_register_conversion_rate_mask, ui8arr_conversion);
+	if (i_status != ADS1115_OK) {
+		return i_status;
 		}
+	*i16_code = ADS1115_get_code(ui8arr_conversion);
+	ADS1115_record_latency(dev, ADS1115_get_timestamp_ns() - ui64_start);
+	return ADS1115_OK;
+	}
 	
-	// leave the pointer on the conversion register, every sample after
-	// this is a plain 2 byte read
-	ui8arr_write_buffer[0] = POINTER_REGISTER_CONVERSION;
-	if (write(i_ADS1115_handle, ui8arr_write_buffer, 1) != 1) {
-		perror("ADS1115_start_continuous - write pointer");
-		return -1;
+int ADS1115_get_single_conversion(ads1115_dev *dev, double *d_conversion) {	
+	int16_t i16_code;
+	float f_resolution;
+	for (;;) {
+		f_resolution = dev->f_resolution;
+		int i_status = ADS1115_get_single_raw(dev, &i16_code);
+		if (i_status != ADS1115_OK) {
+			return i_status;
+			}
+		if (!dev->ui8_autorange || !ADS1115_autorange_update(dev, i16_code)) {
+			break;
+			}
+		ADS1115_STAT_ADD(dev, ui64_retries, 1);
 		}
+	*d_conversion = i16_code * (double)f_resolution;
+	ADS1115_TRACE(ADS1115_TRACE_DEBUG, "conversion = %1.4f (V)", *d_conversion);
+	return ADS1115_OK;
+	}
 	
-	// first result is available one period after the config write
-	clock_gettime(CLOCK_MONOTONIC, &ts_next_sample);
-	ts_next_sample.tv_nsec += ADS1115_get_conversion_period_ns();
-	if (ts_next_sample.tv_nsec >= 1000000000L) {
-		ts_next_sample.tv_sec += ts_next_sample.tv_nsec / 1000000000L;
-		ts_next_sample.tv_nsec %= 1000000000L;
+int ADS1115_start_continuous(ads1115_dev *dev) {
+	// build config register -- continuous conversion. Leave the pointer on
+	// the conversion register, every sample after this is a plain 2 byte
+	// read. Nothing goes out if the chip is already set up this way.
+	struct i2c_msg msgs[4];
+	ADS1115_build_config_register(dev, CONFIG_REGISTER_CONTINUOUS_CONVERSION);
+	if (ADS1115_ready_wait_enabled(dev)) {
+		ADS1115_drain_alert(dev);
+		}
+	int i_count = ADS1115_queue_volt_thresholds(dev, msgs, 0);
+	i_count = ADS1115_queue_write(dev, msgs, i_count, dev->ui8arr_write_buffer, 0);
+	i_count = ADS1115_queue_pointer(dev, msgs, i_count, POINTER_REGISTER_CONVERSION);
+	if (ADS1115_transfer(dev, msgs, i_count) != ADS1115_OK) {
+		return ADS1115_ERROR_IO;
 		}
-	ui8_continuous_configured = 1;
-	return 0;
+	
+	// the chip wakes up for the first conversion as it does for a single shot,
+	// read a guard into the next one so timer jitter and an error in the
+	// learned period have room on either side
+	uint8_t ui8_rate_mask = dev->ui8_config_register_conversion_rate_mask;
+	long l_first_ns = ADS1115_drift_single_ns(dev, ui8_rate_mask) + ADS1115_get_rate_period_ns(ui8_rate_mask) / ADS1115_DRIFT_GUARD_DIVIDER;
+	clock_gettime(CLOCK_MONOTONIC, &dev->ts_next_sample);
+	ADS1115_timespec_add_ns(&dev->ts_next_sample, l_first_ns);
+	dev->ui64_ready_ns = 0;
+	dev->ui8_continuous_configured = 1;
+	return ADS1115_OK;
 	}
 	
-int ADS1115_read_stream(double *darr_buffer, int count) {
+int ADS1115_read_stream_raw(ads1115_dev *dev, int16_t *i16arr_buffer, int count) {
 	// single shot mode has no stream, fall back to one conversion per sample
-	if (ui8_config_register_conversion_mode_mask != CONFIG_REGISTER_CONTINUOUS_CONVERSION) {
+	if (dev->ui8_config_register_conversion_mode_mask != CONFIG_REGISTER_CONTINUOUS_CONVERSION) {
 		for (int c = 0; c < count; c++) {
-			darr_buffer[c] = ADS1115_get_single_conversion();
+			int i_status = ADS1115_get_single_raw(dev, &i16arr_buffer[c]);
+			if (i_status != ADS1115_OK) {
+				return (c > 0) ? c : i_status;
+				}
 			}
 		return count;
 		}
 		
-	if (!ui8_continuous_configured && ADS1115_start_continuous() < 0) {
-		return -1;
+	if (!dev->ui8_continuous_configured) {
+		int i_status = ADS1115_start_continuous(dev);
+		if (i_status != ADS1115_OK) {
+			return i_status;
+			}
+		}
+	
+	if (ADS1115_ready_wait_enabled(dev)) {
+		// one RDY pulse per conversion, read each result as it is signalled
+		for (int c = 0; c < count; c++) {
+			uint64_t ui64_start = ADS1115_get_timestamp_ns();
+			int i_status = ADS1115_wait_alert(dev, dev->i_timeout_ms, &i16arr_buffer[c]);
+			if (i_status != ADS1115_OK) {
+				if (i_status == ADS1115_ERROR_TIMEOUT) {
+					ADS1115_STAT_ADD(dev, ui64_timeouts, 1);
+					}
+				return (c > 0) ? c : i_status;
+				}
+			
+			// edge to edge is a whole number of periods, a late read may have missed some
+			if (dev->ui64_ready_ns != 0 && dev->ui64_alert_ns > dev->ui64_ready_ns) {
+				uint64_t ui64_interval = dev->ui64_alert_ns - dev->ui64_ready_ns;
+				int i_periods = (int)((double)ui64_interval / ADS1115_get_sample_period_ns(dev) + 0.5);
+				if (i_periods >= 1 && i_periods <= ADS1115_DRIFT_EDGE_PERIODS) {
+					ADS1115_drift_edge(dev, dev->ui8_config_register_conversion_rate_mask, ui64_interval / i_periods);
+					}
+				if (i_periods > 1) {
+					ADS1115_STAT_ADD(dev, ui64_skipped, i_periods - 1);
+					}
+				}
+			dev->ui64_ready_ns = dev->ui64_alert_ns;
+			
+			// an edge already pending belongs to a conversion a late register
+			// read has taken, waiting on it would return the same code twice
+			ADS1115_drain_alert(dev);
+			ADS1115_record_latency(dev, ADS1115_get_timestamp_ns() - ui64_start);
+			}
+		return count;
 		}
 	
-	long l_period_ns = ADS1115_get_conversion_period_ns();
 	struct timespec ts_now;
 	for (int c = 0; c < count; c++) {
-		// pace reads to the data rate so no sample is read twice
-		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts_next_sample, NULL);
+		// pace reads to the learned data rate so no sample is read twice
+		clock_gettime(CLOCK_MONOTONIC, &ts_now);
+		uint64_t ui64_start = ADS1115_timespec_to_ns(&ts_now);
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &dev->ts_next_sample, NULL);
 		
-		if (read(i_ADS1115_handle, ui8arr_read_buffer, 2) != 2) {
-			perror("ADS1115_read_stream - read");
-			return c;
+		dev->ui64_ready_ns = ADS1115_get_timestamp_ns() - ADS1115_get_sample_period_ns(dev) / ADS1115_DRIFT_GUARD_DIVIDER;
+		if (ADS1115_read_register(dev, POINTER_REGISTER_CONVERSION, dev->ui8arr_read_buffer) != ADS1115_OK) {
+			return (c > 0) ? c : ADS1115_ERROR_IO;
 			}
-		darr_buffer[c] = ADS1115_convert_read_buffer();
+		i16arr_buffer[c] = ADS1115_get_code(dev->ui8arr_read_buffer);
 		
-		// schedule the next read one period later, resync if we fell behind
-		ts_next_sample.tv_nsec += l_period_ns;
-		if (ts_next_sample.tv_nsec >= 1000000000L) {
-			ts_next_sample.tv_sec += 1;
-			ts_next_sample.tv_nsec -= 1000000000L;
+		// a read that ended later than half the guard past its time may hold
+		// the next conversion, the next read goes past that one as well. Where
+		// the conversions end is only known to a bus transfer and a wake-up; a
+		// read taken for late that was not passes over one conversion more,
+		// counted all the same, and never reads one twice.
+		uint64_t ui64_read_ns = ADS1115_get_timestamp_ns();
+		long l_sample_ns = ADS1115_drift_pace_ns(dev);
+		long l_late_ns = l_sample_ns / (2 * ADS1115_DRIFT_GUARD_DIVIDER);
+		uint64_t ui64_scheduled_ns = ADS1115_timespec_to_ns(&dev->ts_next_sample);
+		if (ui64_read_ns > ui64_scheduled_ns + l_late_ns) {
+			long l_passed = (long)((ui64_read_ns - ui64_scheduled_ns + l_sample_ns - l_late_ns) / l_sample_ns);
+			ADS1115_timespec_add_ns(&dev->ts_next_sample, (int64_t)l_passed * l_sample_ns);
+			ADS1115_STAT_ADD(dev, ui64_skipped, l_passed);
 			}
+		
+		// schedule the next read one period later, whole periods later if we
+		// fell behind -- reading at once would land before the guard
+		ADS1115_timespec_add_ns(&dev->ts_next_sample, l_sample_ns);
 		clock_gettime(CLOCK_MONOTONIC, &ts_now);
-		if (ts_now.tv_sec > ts_next_sample.tv_sec || 
-			(ts_now.tv_sec == ts_next_sample.tv_sec && ts_now.tv_nsec > ts_next_sample.tv_nsec)) {
-			ts_next_sample = ts_now;
+		ADS1115_record_latency(dev, ADS1115_timespec_to_ns(&ts_now) - ui64_start);
+		while (ADS1115_timespec_after(&ts_now, &dev->ts_next_sample)) {
+			ADS1115_timespec_add_ns(&dev->ts_next_sample, l_sample_ns);
+			ADS1115_STAT_ADD(dev, ui64_skipped, 1);
+			}
+		
+		// with the clock not measured the schedule says nothing about where the
+		// conversions fall, keep the next read a whole slowest period after the
+		// end of this one -- a late wake-up would otherwise put both in the same
+		// conversion
+		if (!ADS1115_drift_measured(dev)) {
+			struct timespec ts_spaced = {(time_t)(ui64_read_ns / 1000000000ULL), (long)(ui64_read_ns % 1000000000ULL)};
+			ADS1115_timespec_add_ns(&ts_spaced, l_sample_ns);
+			if (ADS1115_timespec_after(&ts_spaced, &dev->ts_next_sample)) {
+				dev->ts_next_sample = ts_spaced;
+				}
+			}
+		}
+	return count;
+	}
+	
+int ADS1115_read_stream(ads1115_dev *dev, double *darr_buffer, int count) {
+	if (dev->ui8_autorange) {
+		// the range may change from one sample to the next, convert each on its own
+		ads1115_sample sample;
+		for (int c = 0; c < count; c++) {
+			int i_read = ADS1115_read_samples(dev, &sample, 1);
+			if (i_read < 1) {
+				return (c > 0) ? c : i_read;
+				}
+			darr_buffer[c] = ADS1115_sample_to_volts(&sample);
+			}
+		return count;
+		}
+	
+	// read raw codes in chunks and convert each chunk in one batch
+	int16_t i16arr_chunk[ADS1115_STREAM_CHUNK];
+	int i_total = 0;
+	while (i_total < count) {
+		int i_wanted = count - i_total;
+		if (i_wanted > ADS1115_STREAM_CHUNK) {
+			i_wanted = ADS1115_STREAM_CHUNK;
+			}
+		int i_read = ADS1115_read_stream_raw(dev, i16arr_chunk, i_wanted);
+		if (i_read < 0) {
+			return (i_total > 0) ? i_total : i_read;
+			}
+		ADS1115_codes_to_volts_double(i16arr_chunk, &darr_buffer[i_total], i_read, dev->ui8_config_register_pga_mask);
+		i_total += i_read;
+		if (i_read < i_wanted) {
+			break;
 			}
 		}
+	return i_total;
+	}
+	
+int ADS1115_read_samples(ads1115_dev *dev, ads1115_sample *samples, int count) {
+	// raw reads tagged with the time and the masks they were converted with
+	int c = 0;
+	while (c < count) {
+		uint8_t ui8_pga_mask = dev->ui8_config_register_pga_mask;
+		int16_t i16_code;
+		int i_read = ADS1115_read_stream_raw(dev, &i16_code, 1);
+		if (i_read < 1) {
+			return (c > 0) ? c : i_read;
+			}
+		if (dev->ui8_autorange && ADS1115_autorange_update(dev, i16_code)) {
+			ADS1115_STAT_ADD(dev, ui64_retries, 1);
+			continue;
+			}
+		ADS1115_tag_sample(dev, &samples[c], dev->ui64_ready_ns, i16_code);
+		samples[c].ui8_pga_mask = ui8_pga_mask;
+		if (dev->ui8_adaptive_rate) {
+			ADS1115_adaptive_update(dev, ui8_pga_mask, i16_code);
+			}
+		c++;
+		}
 	return count;
 	}
 	
-double ADS1115_get_average_conversions(int count) {
-	puts("ADS1115_average_conversions");
-	double d_temp_average = 0;
-	double d_temp_sum = 0;
+void ADS1115_tag_sample(ads1115_dev *dev, ads1115_sample *sample, uint64_t ui64_timestamp_ns, int16_t i16_code) {
+	// a code read with the current setup, stamped with where and when it came from
+	sample->ui64_timestamp_ns = ui64_timestamp_ns;
+	sample->ui32_sequence = dev->ui32_sequence++;
+	sample->i16_code = i16_code;
+	sample->ui8_mult_mask = dev->ui8_config_register_mult_mask;
+	sample->ui8_pga_mask = dev->ui8_config_register_pga_mask;
+	sample->ui8_rate_mask = dev->ui8_config_register_conversion_rate_mask;
+	sample->ui8_bus_id = (uint8_t)dev->i_bus_id;
+	sample->ui8_address = dev->ui8_address;
+	}
+	
+double ADS1115_sample_to_volts(const ads1115_sample *sample) {
+	return sample->i16_code * (double)ADS1115_get_pga_resolution(sample->ui8_pga_mask);
+	}
+	
+void ADS1115_scan_clear(ads1115_dev *dev) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_scan_clear");
+	dev->i_scan_count = 0;
+	}
+	
+int ADS1115_scan_add(ads1115_dev *dev, enum MULT_MASK mult, enum PGA_MASK pga, enum RATE_MASK sps) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_scan_add");
+	if (dev->i_scan_count >= ADS1115_SCAN_LIST_MAX) {
+		ADS1115_TRACE(ADS1115_TRACE_WARNING, "ADS1115_scan_add - scan list full");
+		return ADS1115_ERROR_INVALID;
+		}
+	ads1115_scan_entry *entry = &dev->scan_list[dev->i_scan_count++];
+	entry->ui8_mult_mask = mult;
+	entry->ui8_pga_mask = pga;
+	entry->ui8_rate_mask = sps;
+	entry->ui8_converted_rate_mask = sps;
+	entry->f_resolution = ADS1115_get_pga_resolution(pga);
+	entry->adaptive.ui8_valid = 0;
+	entry->ui64_ready_ns = 0;
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "scan entry %d set to: %d %d %d", dev->i_scan_count - 1, mult, pga, sps);
+	return ADS1115_OK;
+	}
+	
+void ADS1115_scan_apply_entry(ads1115_dev *dev, int i_entry) {
+	// the caller's setup with the entry's channel, gain and rate patched
+	// into the write buffer -- the setter state is left alone, so single
+	// reads after a sweep keep what the caller chose
+	ads1115_scan_entry *entry = &dev->scan_list[i_entry];
+	ADS1115_build_config_register(dev, CONFIG_REGISTER_SINGLE_CONVERSION);
+	dev->ui8arr_write_buffer[1] &= ~(0b01110000 | 0b00001110);	// bit 14-12, bit 11-9
+	dev->ui8arr_write_buffer[1] |= entry->ui8_mult_mask | entry->ui8_pga_mask;
+	dev->ui8arr_write_buffer[2] &= ~0b11100000;					// bit 7-5
+	dev->ui8arr_write_buffer[2] |= entry->ui8_rate_mask;
+	}
+	
+int ADS1115_scan_start_entry(ads1115_dev *dev, int i_entry, struct timespec *ts_start) {
+	ADS1115_scan_apply_entry(dev, i_entry);
+	if (ADS1115_write_register(dev, dev->ui8arr_write_buffer, 1) != ADS1115_OK) {
+		return ADS1115_ERROR_IO;
+		}
+	clock_gettime(CLOCK_MONOTONIC, ts_start);
+	return ADS1115_OK;
+	}
+	
+int ADS1115_scan_sweep_raw(ads1115_dev *dev, int16_t *i16arr_results) {
+	// the config register now follows the scan list, not the setters
+	dev->ui8_continuous_configured = 0;
+	if (dev->i_scan_count == 0) {
+		return 0;
+		}
+	
+	struct timespec ts_start;
+	int i_status = ADS1115_scan_start_entry(dev, 0, &ts_start);
+	if (i_status != ADS1115_OK) {
+		return i_status;
+		}
+	
+	for (int c = 0; c < dev->i_scan_count; c++) {
+		ads1115_scan_entry *entry = &dev->scan_list[c];
+		i_status = ADS1115_wait_conversion(dev, &ts_start, entry->ui8_rate_mask, NULL);
+		if (i_status != ADS1115_OK) {
+			return i_status;
+			}
+		entry->ui64_ready_ns = dev->ui64_ready_ns;
+		
+		// collect this entry and start the next one in the same transaction,
+		// no bus turnaround between the two. The read goes first: it can
+		// never meet the next result however late the thread runs, and the
+		// config write ends the transaction, so the time taken after it is
+		// when the next conversion started.
+		struct i2c_msg msgs[3];
+		int i_count = ADS1115_queue_read(dev, msgs, 0, POINTER_REGISTER_CONVERSION, dev->ui8arr_read_buffer);
+		if (c + 1 < dev->i_scan_count) {
+			ADS1115_scan_apply_entry(dev, c + 1);
+			i_count = ADS1115_queue_write(dev, msgs, i_count, dev->ui8arr_write_buffer, 1);
+			}
+		uint64_t ui64_start = ADS1115_timespec_to_ns(&ts_start);
+		i_status = ADS1115_transfer(dev, msgs, i_count);
+		clock_gettime(CLOCK_MONOTONIC, &ts_start);
+		if (i_status != ADS1115_OK) {
+			return i_status;
+			}
+		i16arr_results[c] = ADS1115_get_code(dev->ui8arr_read_buffer);
+		ADS1115_record_latency(dev, ADS1115_timespec_to_ns(&ts_start) - ui64_start);
+		
+		// the entry converts at its new rate from the next sweep on
+		entry->ui8_converted_rate_mask = entry->ui8_rate_mask;
+		if (dev->ui8_adaptive_rate) {
+			entry->ui8_rate_mask = ADS1115_adaptive_select(dev, &entry->adaptive, entry->ui8_rate_mask, entry->ui8_pga_mask, i16arr_results[c]);
+			}
+		}
+	return dev->i_scan_count;
+	}
+	
+int ADS1115_scan_sweep(ads1115_dev *dev, double *darr_results) {
+	int16_t i16arr_codes[ADS1115_SCAN_LIST_MAX];
+	int i_count = ADS1115_scan_sweep_raw(dev, i16arr_codes);
+	for (int c = 0; c < i_count; c++) {
+		darr_results[c] = i16arr_codes[c] * (double)dev->scan_list[c].f_resolution;
+		}
+	return i_count;
+	}
+	
+int ADS1115_scan_sweep_samples(ads1115_dev *dev, ads1115_sample *samples) {
+	// each result with the entry's masks as converted, stamped when it finished
+	int16_t i16arr_codes[ADS1115_SCAN_LIST_MAX];
+	int i_count = ADS1115_scan_sweep_raw(dev, i16arr_codes);
+	for (int c = 0; c < i_count; c++) {
+		ads1115_scan_entry *entry = &dev->scan_list[c];
+		ADS1115_tag_sample(dev, &samples[c], entry->ui64_ready_ns, i16arr_codes[c]);
+		samples[c].ui8_mult_mask = entry->ui8_mult_mask;
+		samples[c].ui8_pga_mask = entry->ui8_pga_mask;
+		samples[c].ui8_rate_mask = entry->ui8_converted_rate_mask;
+		}
+	return i_count;
+	}
+	
+int ADS1115_shared_bus(ads1115_dev **devs, int count) {
+	// one I2C_RDWR call can only address devices behind the same transport
+	// instance. Every Linux handle opens its own fd, but the bus id names
+	// /dev/i2c-N there; any other transport is only the same bus on the
+	// same context.
+	for (int c = 1; c < count; c++) {
+		if (devs[c]->i_bus_id != devs[0]->i_bus_id || 
+			devs[c]->transport.transfer != devs[0]->transport.transfer ||
+			(devs[c]->transport.transfer != ADS1115_linux_transfer && devs[c]->transport.context != devs[0]->transport.context)) {
+			return 0;
+			}
+		}
+	return 1;
+	}
+	
+int ADS1115_batch_transfer(ads1115_dev **devs, int count, struct i2c_msg *msgs, int i_count) {
+	// ADS1115_transfer() only forgets the shadows of the device it went through
+	if (ADS1115_transfer(devs[0], msgs, i_count) != ADS1115_OK) {
+		for (int c = 1; c < count; c++) {
+			ADS1115_invalidate_shadow(devs[c]);
+			}
+		return ADS1115_ERROR_IO;
+		}
+	return ADS1115_OK;
+	}
+	
+int ADS1115_read_conversion_batch(ads1115_dev **devs, int count, double *darr_results) {
+	// devices sharing a bus are read in one I2C_RDWR call, anything else
+	// falls back to one combined pointer + read transaction per device
+	struct i2c_msg msgs[ADS1115_BATCH_MAX * 2];
+	int i_batch = (count <= ADS1115_BATCH_MAX && ADS1115_shared_bus(devs, count));
+	
+	if (i_batch && count > 0) {
+		int i_count = 0;
+		for (int c = 0; c < count; c++) {
+			i_count = ADS1115_queue_read(devs[c], msgs, i_count, POINTER_REGISTER_CONVERSION, devs[c]->ui8arr_read_buffer);
+			}
+		if (ADS1115_batch_transfer(devs, count, msgs, i_count) != ADS1115_OK) {
+			return ADS1115_ERROR_IO;
+			}
+		}
+	else {
+		for (int c = 0; c < count; c++) {
+			if (ADS1115_read_register(devs[c], POINTER_REGISTER_CONVERSION, devs[c]->ui8arr_read_buffer) != ADS1115_OK) {
+				return ADS1115_ERROR_IO;
+				}
+			}
+		}
+	
 	for (int c = 0; c < count; c++) {
-		d_temp_sum += ADS1115_get_single_conversion();
+		darr_results[c] = ADS1115_convert_read_buffer(devs[c], devs[c]->f_resolution);
 		}
-	d_temp_average = d_temp_sum / count;
-	printf("average = %1.4lf (%d conversions)\n", d_temp_average, count);
-	return d_temp_average;
+	return count;
 	}
 	
-void ADS1115_init(int id, enum ADS1115_ADDRESS addr) {
-	puts("ADS1115_init");	
-	char carr_temp_I2C_name[15] = {0};	
+int ADS1115_read_samples_staggered(ads1115_dev **devs, int count, ads1115_sample *samples) {
+	// one single shot conversion per device, samples are written in completion order
+	if (count > ADS1115_STAGGER_MAX || !ADS1115_shared_bus(devs, count)) {
+		// nothing to overlap across buses, convert one after the other
+		int i_total = 0;
+		for (int c = 0; c < count; c++) {
+			int i_read = ADS1115_read_samples(devs[c], &samples[i_total], 1);
+			if (i_read < 0) {
+				return (i_total > 0) ? i_total : i_read;
+				}
+			i_total += i_read;
+			}
+		return i_total;
+		}
+	
+	// start every chip in one transaction, the conversions then run side by side
+	struct i2c_msg msgs[ADS1115_STAGGER_MAX * 4];
+	int i_count = 0;
+	for (int c = 0; c < count; c++) {
+		ADS1115_build_config_register(devs[c], CONFIG_REGISTER_SINGLE_CONVERSION);
+		devs[c]->ui8_continuous_configured = 0;
+		i_count = ADS1115_queue_volt_thresholds(devs[c], msgs, i_count);
+		i_count = ADS1115_queue_write(devs[c], msgs, i_count, devs[c]->ui8arr_write_buffer, 1);
+		}
+	if (ADS1115_batch_transfer(devs, count, msgs, i_count) != ADS1115_OK) {
+		return ADS1115_ERROR_IO;
+		}
+	
+	uint64_t ui64_start = ADS1115_get_timestamp_ns();
+	uint64_t ui64arr_start[ADS1115_STAGGER_MAX];
+	uint64_t ui64arr_due[ADS1115_STAGGER_MAX];
+	uint64_t ui64arr_deadline[ADS1115_STAGGER_MAX];
+	uint8_t ui8arr_conversion[ADS1115_STAGGER_MAX][2];
+	uint8_t ui8arr_polls[ADS1115_STAGGER_MAX] = {0};
+	int i_pending = count;
+	for (int c = 0; c < count; c++) {
+		// each chip at its own learned oscillator speed
+		ui64arr_start[c] = ui64_start;
+		ui64arr_due[c] = ui64_start + ADS1115_drift_first_poll_ns(devs[c], devs[c]->ui8_config_register_conversion_rate_mask);
+		ui64arr_deadline[c] = ui64_start + devs[c]->i_timeout_ms * 1000000ULL;
+		if (ui64arr_due[c] > ui64arr_deadline[c]) {
+			ui64arr_due[c] = ui64arr_deadline[c];
+			}
+		}
+	
+	int i_total = 0;
+	int i_status = ADS1115_OK;
+	while (i_pending > 0) {
+		// sleep until the first chip may be done
+		uint64_t ui64_due = UINT64_MAX;
+		for (int c = 0; c < count; c++) {
+			if (ui64arr_due[c] < ui64_due) {
+				ui64_due = ui64arr_due[c];
+				}
+			}
+		struct timespec ts_wait = {ui64_due / 1000000000ULL, ui64_due % 1000000000ULL};
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts_wait, NULL);
+		
+		// poll every chip that is due in one transaction, config and conversion each
+		uint64_t ui64_now = ADS1115_get_timestamp_ns();
+		i_count = 0;
+		for (int c = 0; c < count; c++) {
+			if (ui64arr_due[c] <= ui64_now) {
+				ADS1115_STAT_ADD(devs[c], ui64_polls, 1);
+				i_count = ADS1115_queue_read(devs[c], msgs, i_count, POINTER_REGISTER_CONFIG, devs[c]->ui8arr_read_buffer);
+				i_count = ADS1115_queue_read(devs[c], msgs, i_count, POINTER_REGISTER_CONVERSION, ui8arr_conversion[c]);
+				}
+			}
+		uint64_t ui64_sent = ui64_now;
+		if (ADS1115_batch_transfer(devs, count, msgs, i_count) != ADS1115_OK) {
+			return (i_total > 0) ? i_total : ADS1115_ERROR_IO;
+			}
+		ui64_now = ADS1115_get_timestamp_ns();
+		
+		for (int c = 0; c < count; c++) {
+			if (ui64arr_due[c] > ui64_sent) {
+				continue;
+				}
+			ads1115_dev *dev = devs[c];
+			uint8_t ui8_rate_mask = dev->ui8_config_register_conversion_rate_mask;
+			long l_period_ns = ADS1115_get_rate_period_ns(ui8_rate_mask);
+			if (dev->ui8arr_read_buffer[0] & CONFIG_REGISTER_IDLE) {
+				int16_t i16_code = ADS1115_get_code(ui8arr_conversion[c]);
+				uint8_t ui8_pga_mask = dev->ui8_config_register_pga_mask;
+				dev->ui64_ready_ns = ADS1115_drift_done(dev, ui8_rate_mask, ui64arr_start[c], ui64_now, ui8arr_polls[c] == 0);
+				if (dev->ui8_autorange && ADS1115_autorange_update(dev, i16_code)) {
+					// clipped, convert this chip again at the wider range like ADS1115_read_samples()
+					ADS1115_STAT_ADD(dev, ui64_retries, 1);
+					if (ADS1115_start_single_raw(dev) != ADS1115_OK) {
+						return (i_total > 0) ? i_total : ADS1115_ERROR_IO;
+						}
+					ui64arr_start[c] = ADS1115_get_timestamp_ns();
+					ui64arr_due[c] = ui64arr_start[c] + ADS1115_drift_first_poll_ns(dev, dev->ui8_config_register_conversion_rate_mask);
+					if (ui64arr_due[c] > ui64arr_deadline[c]) {
+						ui64arr_due[c] = ui64arr_deadline[c];
+						}
+					ui8arr_polls[c] = 0;
+					continue;
+					}
+				ADS1115_tag_sample(dev, &samples[i_total], dev->ui64_ready_ns, i16_code);
+				samples[i_total++].ui8_pga_mask = ui8_pga_mask;
+				ADS1115_record_latency(dev, ui64_now - ui64arr_start[c]);
+				if (dev->ui8_adaptive_rate) {
+					ADS1115_adaptive_update(dev, ui8_pga_mask, i16_code);
+					}
+				ui64arr_due[c] = UINT64_MAX;
+				i_pending--;
+				}
+			else if (ui64_now > ui64arr_deadline[c]) {
+				ADS1115_TRACE(ADS1115_TRACE_WARNING, "ADS1115_read_samples_staggered - timeout on 0x%02x", dev->ui8_address);
+				ADS1115_STAT_ADD(dev, ui64_timeouts, 1);
+				ui64arr_due[c] = UINT64_MAX;
+				i_pending--;
+				i_status = ADS1115_ERROR_TIMEOUT;
+				}
+			else {
+				// a first poll pulled in to the deadline says nothing about the latency
+				if (ui8arr_polls[c]++ == 0 && ui64arr_due[c] < ui64arr_deadline[c]) {
+					ADS1115_drift_busy(dev, ui8_rate_mask, ui64arr_start[c], ui64_sent);
+					}
+				ui64arr_due[c] = ui64_now + l_period_ns / ADS1115_POLL_DIVIDER;
+				}
+			}
+		}
+	return (i_total > 0) ? i_total : i_status;
+	}
+	
+int ADS1115_set_thresholds_raw(ads1115_dev *dev, int16_t i16_low, int16_t i16_high) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_set_thresholds_raw");
+	// codes stay codes, whatever the PGA does later
+	int i_status = ADS1115_write_thresholds(dev, i16_low, i16_high);
+	if (i_status == ADS1115_OK) {
+		dev->ui8_thresholds_volts = 0;
+		}
+	return i_status;
+	}
+	
+int ADS1115_set_thresholds(ads1115_dev *dev, double d_low_volts, double d_high_volts) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_set_thresholds");
+	// kept in volts, rewritten with the next conversion whenever the PGA changes
+	int i_status = ADS1115_write_thresholds(dev, ADS1115_volts_to_code(dev, d_low_volts), ADS1115_volts_to_code(dev, d_high_volts));
+	if (i_status == ADS1115_OK) {
+		dev->ui8_thresholds_volts = 1;
+		dev->d_threshold_low_volts = d_low_volts;
+		dev->d_threshold_high_volts = d_high_volts;
+		}
+	return i_status;
+	}
+	
+int ADS1115_open_alert_gpio(ads1115_dev *dev, const char *cp_chip, int i_line) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_open_alert_gpio");
+	int i_chip = open(cp_chip, O_RDONLY | O_CLOEXEC);
+	if (i_chip < 0) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_open_alert_gpio - open: %s", strerror(errno));
+		return ADS1115_ERROR_IO;
+		}
+	
+	// wake only on the edge that asserts the pin, per the comparator polarity
+	struct gpio_v2_line_request request;
+	memset(&request, 0, sizeof(request));
+	request.offsets[0] = i_line;
+	request.num_lines = 1;
+	request.config.flags = GPIO_V2_LINE_FLAG_INPUT;
+	if (dev->ui8_config_register_comparator_polarity_mask == CONFIG_REGISTER_COMPARATOR_POLARITY_HIGH) {
+		request.config.flags |= GPIO_V2_LINE_FLAG_EDGE_RISING;
+		}
+	else {
+		request.config.flags |= GPIO_V2_LINE_FLAG_EDGE_FALLING;
+		}
+	strncpy(request.consumer, ADS1115_ALERT_CONSUMER, sizeof(request.consumer) - 1);
+	int i_result = ioctl(i_chip, GPIO_V2_GET_LINE_IOCTL, &request);
+	close(i_chip);
+	if (i_result < 0) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_open_alert_gpio - ioctl GPIO_V2_GET_LINE: %s", strerror(errno));
+		return ADS1115_ERROR_IO;
+		}
+	
+	if (dev->ui8_alert_owned) {
+		close(dev->i_alert_fd);
+		}
+	dev->i_alert_fd = request.fd;
+	dev->ui8_alert_owned = 1;
+	return ADS1115_OK;
+	}
+	
+void ADS1115_set_alert_fd(ads1115_dev *dev, int fd) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_set_alert_fd");
+	// the caller keeps ownership of fd, -1 detaches
+	if (dev->ui8_alert_owned) {
+		close(dev->i_alert_fd);
+		}
+	dev->i_alert_fd = fd;
+	dev->ui8_alert_owned = 0;
+	}
+	
+int ADS1115_set_ready_mode(ads1115_dev *dev, int i_enable) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_set_ready_mode");
+	// comparator on, asserting after every conversion; off gives the comparator
+	// back the queue and thresholds it had before
+	if ((i_enable != 0) == dev->ui8_ready_mode) {
+		return ADS1115_OK;
+		}
+	int i_status;
+	if (i_enable) {
+		int16_t i16_low = dev->i16_threshold_low;
+		int16_t i16_high = dev->i16_threshold_high;
+		// Hi_thresh MSB 1, Lo_thresh MSB 0 selects the conversion-ready function
+		i_status = ADS1115_write_thresholds(dev, 0x0000, INT16_MIN);
+		if (i_status != ADS1115_OK) {
+			return i_status;
+			}
+		dev->ui8_ready_saved_queue_mask = dev->ui8_config_register_comparator_queue_mask;
+		dev->i16_ready_saved_low = i16_low;
+		dev->i16_ready_saved_high = i16_high;
+		dev->ui8_config_register_comparator_queue_mask = CONFIG_REGISTER_COMPARATOR_QUEUE_LENGTH_1;
+		}
+	else {
+		if (dev->ui8_thresholds_volts) {
+			// the PGA may have changed while ready mode held the registers
+			dev->i16_ready_saved_low = ADS1115_volts_to_code(dev, dev->d_threshold_low_volts);
+			dev->i16_ready_saved_high = ADS1115_volts_to_code(dev, dev->d_threshold_high_volts);
+			}
+		i_status = ADS1115_write_thresholds(dev, dev->i16_ready_saved_low, dev->i16_ready_saved_high);
+		dev->ui8_config_register_comparator_queue_mask = dev->ui8_ready_saved_queue_mask;
+		}
+	dev->ui8_ready_mode = (i_enable != 0);
+	dev->ui8_continuous_configured = 0;
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ready mode set to: %d", dev->ui8_ready_mode);
+	return i_status;
+	}
+	
+int ADS1115_wait_alert(ads1115_dev *dev, int i_timeout_ms, int16_t *i16_code) {
+	// sleep until ALERT/RDY fires, a negative timeout waits forever
+	if (dev->i_alert_fd < 0) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_wait_alert - no alert fd");
+		return ADS1115_ERROR_INVALID;
+		}
+	// a signal only shortens the wait, the deadline stays where it was
+	struct pollfd poll_alert = {dev->i_alert_fd, POLLIN | POLLPRI, 0};
+	uint64_t ui64_deadline = ADS1115_get_timestamp_ns() + (uint64_t)i_timeout_ms * 1000000;
+	int i_remaining_ms = i_timeout_ms;
+	int i_ready;
+	for (;;) {
+		i_ready = poll(&poll_alert, 1, i_remaining_ms);
+		if (i_ready >= 0 || errno != EINTR) {
+			break;
+			}
+		if (i_timeout_ms >= 0) {
+			uint64_t ui64_now = ADS1115_get_timestamp_ns();
+			// round up, poll() would otherwise spin on the last partial millisecond
+			i_remaining_ms = (ui64_now >= ui64_deadline) ? 0 : (int)((ui64_deadline - ui64_now + 999999) / 1000000);
+			}
+		}
+	if (i_ready < 0) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_wait_alert - poll: %s", strerror(errno));
+		return ADS1115_ERROR_IO;
+		}
+	if (i_ready == 0) {
+		return ADS1115_ERROR_TIMEOUT;
+		}
+	
+	// drain the pending edge events, an eventfd counter reads out the same way
+	struct gpio_v2_line_event events[ADS1115_ALERT_EVENTS];
+	dev->ui64_alert_ns = ADS1115_get_timestamp_ns();
+	ssize_t i_bytes = read(dev->i_alert_fd, events, sizeof(events));
+	if (i_bytes < 0) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_wait_alert - read: %s", strerror(errno));
+		return ADS1115_ERROR_IO;
+		}
+	
+	// GPIO edges carry their CLOCK_MONOTONIC time, anything else is stamped on wakeup
+	if ((size_t)i_bytes >= sizeof(struct gpio_v2_line_event)) {
+		dev->ui64_alert_ns = events[i_bytes / sizeof(struct gpio_v2_line_event) - 1].timestamp_ns;
+		}
+	
+	// reading the conversion register also releases a latching comparator
+	if (i16_code != NULL) {
+		if (ADS1115_read_register(dev, POINTER_REGISTER_CONVERSION, dev->ui8arr_read_buffer) != ADS1115_OK) {
+			return ADS1115_ERROR_IO;
+			}
+		*i16_code = ADS1115_get_code(dev->ui8arr_read_buffer);
+		}
+	return ADS1115_OK;
+	}
+	
+void ADS1115_record_latency(ads1115_dev *dev, uint64_t ui64_latency_ns) {
+	// one finished conversion into the counters and the log2 microsecond histogram
+	uint64_t ui64_us = ui64_latency_ns / 1000;
+	int i_bucket = (ui64_us < 2) ? 0 : 63 - __builtin_clzll(ui64_us);
+	if (i_bucket >= ADS1115_LATENCY_BUCKETS) {
+		i_bucket = ADS1115_LATENCY_BUCKETS - 1;
+		}
+	ADS1115_STAT_ADD(dev, ui64arr_latency[i_bucket], 1);
+	ADS1115_STAT_ADD(dev, ui64_conversions, 1);
+	ADS1115_STAT_ADD(dev, ui64_latency_total_ns, ui64_latency_ns);
+	if (ui64_latency_ns > dev->stats.ui64_latency_max_ns) {
+		__atomic_store_n(&dev->stats.ui64_latency_max_ns, ui64_latency_ns, __ATOMIC_RELAXED);
+		}
+	}
+	
+void ADS1115_get_stats(ads1115_dev *dev, ads1115_stats *stats) {
+	// safe while another thread drives the device, ads1115_stats is all uint64_t
+	const uint64_t *ui64arr_source = (const uint64_t *)&dev->stats;
+	uint64_t *ui64arr_target = (uint64_t *)stats;
+	for (size_t c = 0; c < sizeof(ads1115_stats) / sizeof(uint64_t); c++) {
+		ui64arr_target[c] = __atomic_load_n(&ui64arr_source[c], __ATOMIC_RELAXED);
+		}
+	}
+	
+uint64_t ADS1115_stats_latency_percentile_ns(const ads1115_stats *stats, double d_percentile) {
+	// upper edge of the bucket holding the percentile, 0 before any conversion
+	uint64_t ui64_rank = (uint64_t)(d_percentile / 100.0 * stats->ui64_conversions + 0.5);
+	if (ui64_rank < 1) {
+		ui64_rank = 1;
+		}
+	uint64_t ui64_seen = 0;
+	for (int c = 0; c < ADS1115_LATENCY_BUCKETS - 1; c++) {
+		ui64_seen += stats->ui64arr_latency[c];
+		if (ui64_seen >= ui64_rank) {
+			return (2ULL << c) * 1000;
+			}
+		}
+	return (stats->ui64_conversions > 0) ? stats->ui64_latency_max_ns : 0;
+	}
+	
+int ADS1115_get_average_conversions(ads1115_dev *dev, int count, double *d_average) {
+	ADS1115_TRACE(ADS1115_TRACE_DEBUG, "ADS1115_average_conversions");
+	if (count <= 0) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_get_average_conversions - count %d", count);
+		return ADS1115_ERROR_INVALID;
+		}
+	if (dev->ui8_autorange) {
+		// the range may change between samples, sum volts rather than codes
+		ads1115_sample sample;
+		double d_sum = 0;
+		for (int c = 0; c < count; c++) {
+			int i_read = ADS1115_read_samples(dev, &sample, 1);
+			if (i_read < 1) {
+				return (i_read < 0) ? i_read : ADS1115_ERROR_IO;
+				}
+			d_sum += ADS1115_sample_to_volts(&sample);
+			}
+		*d_average = d_sum / count;
+		ADS1115_TRACE(ADS1115_TRACE_DEBUG, "average = %1.4lf (%d conversions)", *d_average, count);
+		return ADS1115_OK;
+		}
+	
+	// sum raw codes and scale once, continuous mode reads them off the running stream
+	int16_t i16arr_chunk[ADS1115_STREAM_CHUNK];
+	int64_t i64_sum = 0;
+	int i_total = 0;
+	while (i_total < count) {
+		int i_wanted = count - i_total;
+		if (i_wanted > ADS1115_STREAM_CHUNK) {
+			i_wanted = ADS1115_STREAM_CHUNK;
+			}
+		int i_read = ADS1115_read_stream_raw(dev, i16arr_chunk, i_wanted);
+		if (i_read < i_wanted) {
+			return (i_read < 0) ? i_read : ADS1115_ERROR_IO;
+			}
+		for (int c = 0; c < i_read; c++) {
+			i64_sum += i16arr_chunk[c];
+			}
+		i_total += i_read;
+		}
+	*d_average = (double)i64_sum / count * dev->f_resolution;
+	ADS1115_TRACE(ADS1115_TRACE_DEBUG, "average = %1.4lf (%d conversions)", *d_average, count);
+	return ADS1115_OK;
+	}
+	
+ads1115_dev *ADS1115_init_transport(const ads1115_transport *transport, int id, enum ADS1115_ADDRESS addr) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_init_transport");	
+	ads1115_dev *dev = calloc(1, sizeof(ads1115_dev));
+	if (dev == NULL) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_init - calloc: %s", strerror(errno));
+		return NULL;
+		}
+	dev->transport = *transport;
+	dev->i_bus_id = id;
+	dev->ui8_address = addr;
+	
+	// power-on defaults of the library
+	dev->ui8_config_register_operation_mask = CONFIG_REGISTER_IDLE; 
+	dev->ui8_config_register_mult_mask = CONFIG_REGISTER_MULT_AIN_0; 
+	dev->ui8_config_register_pga_mask = CONFIG_REGISTER_PGA_4_096;
+	dev->ui8_config_register_conversion_mode_mask = CONFIG_REGISTER_SINGLE_CONVERSION;
+	dev->ui8_config_register_conversion_rate_mask = CONFIG_REGISTER_SPS_32;
+	dev->ui8_config_register_comparator_mode_mask = CONFIG_REGISTER_COMPARATOR_MODE_TRADITIONAL;
+	dev->ui8_config_register_comparator_polarity_mask = CONFIG_REGISTER_COMPARATOR_POLARITY_LOW;
+	dev->ui8_config_register_comparator_latch_mask = CONFIG_REGISTER_COMPARATOR_NON_LATCHING;
+	dev->ui8_config_register_comparator_queue_mask = CONFIG_REGISTER_COMPARATOR_QUEUE_DISABLED;
+	dev->f_resolution = (PGA_4_096V / 32768.0);
+	dev->i_timeout_ms = ADS1115_DEFAULT_TIMEOUT_MS;
+	dev->ui8_adaptive_slowest = SPS_8;
+	dev->ui8_adaptive_fastest = SPS_860;
+	dev->i16_adaptive_quiet = ADS1115_ADAPTIVE_QUIET_CODES;
+	dev->i16_adaptive_busy = ADS1115_ADAPTIVE_BUSY_CODES;
+	dev->d_clock_ratio = 1.0;
+	for (int r = 0; r < 8; r++) {
+		dev->darr_poll_margin[r] = ADS1115_DRIFT_MARGIN_PERCENT / 100.0;
+		}
+	dev->i_alert_fd = -1;
+	dev->i16_threshold_low = INT16_MIN;
+	dev->i16_threshold_high = INT16_MAX;
+	ADS1115_invalidate_shadow(dev);
+	return dev;
+	}
+	
+int ADS1115_linux_get_transport(int id, enum ADS1115_ADDRESS addr, ads1115_transport *transport) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_linux_get_transport");
+	char carr_temp_I2C_name[15] = {0};
+	
+	// open i2c data stream	
+	sprintf(carr_temp_I2C_name, "/dev/i2c-%i", id);
+	int i_handle = open(carr_temp_I2C_name, O_RDWR);
+	if (i_handle < 0) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_linux_get_transport - open: %s", strerror(errno));
+		return ADS1115_ERROR_IO;
+		} 			
+	
+	// set I2C slave
+	if (ioctl(i_handle, I2C_SLAVE, addr) < 0) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_linux_get_transport - ioctl I2CSLAVE connect: %s", strerror(errno));	
+		close(i_handle);
+		return ADS1115_ERROR_IO;
+		} 	
+	
+	transport->transfer = ADS1115_linux_transfer;
+	transport->close = ADS1115_linux_close;
+	transport->context = (void *)(intptr_t)i_handle;
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_linux_get_transport - Successfully opened %s @ 0x%02X as I2C_SLAVE", carr_temp_I2C_name, addr);	
+	return ADS1115_OK;
+	}
+	
+ads1115_dev *ADS1115_init(int id, enum ADS1115_ADDRESS addr) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_init");	
 	
 	// validate address
 	if (addr < 0x48) {
@@ -319,17 +1745,14 @@ void ADS1115_init(int id, enum ADS1115_ADDRESS addr) {
 		id = 255; 
 		}		
 	
-	// open i2c data stream	
-	sprintf(carr_temp_I2C_name, "/dev/i2c-%i", id);
-	i_ADS1115_handle = open(carr_temp_I2C_name, O_RDWR);
-	if (i_ADS1115_handle < 0) {
-		perror("ADS1115_init - open");
-		} 			
-	
-	// set I2C slave
-	if (ioctl(i_ADS1115_handle, I2C_SLAVE, addr) < 0) {
-		perror("ADS1115_init - ioctl I2CSLAVE connect");	
-		} 	
-		
-	printf("ADS1115_init - Successfully opened %s @ 0x%02X as I2C_SLAVE\n", carr_temp_I2C_name, addr);	
+	ads1115_transport transport;
+	if (ADS1115_linux_get_transport(id, addr, &transport) != ADS1115_OK) {
+		return NULL;
+		}
+	ads1115_dev *dev = ADS1115_init_transport(&transport, id, addr);
+	if (dev == NULL) {
+		transport.close(transport.context);
+		return NULL;
+		}
+	return dev;
 	}	
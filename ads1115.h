@@ -100,16 +100,30 @@
  *		11 : Disable comparator and set ALERT/RDY pin to high-impedance (default) 
  *||||||||||||||||||||||||||||||||||||||||||||||||||||||||||||||||||| */ 
  
+#ifndef ADS1115_H
+#define ADS1115_H
+
 //IMPORT****************************************************************
 #include <stdio.h>			// perror(), printf() family, ect.
 #include <inttypes.h>		// uint8_t, ect.
+#include <stdlib.h>			// calloc(), free()
+#include <stdarg.h>			// va_list for the trace sink
+#include <string.h>			// strerror()
+#include <errno.h>			// errno
 // i2c required headers
 #include <unistd.h>			// read(), write(), usleep()
 #include <fcntl.h>			// filecontrol - open()
-#include <linux/i2c-dev.h> 	// I2C bus definitions
+#include <linux/i2c.h>		// struct i2c_msg, I2C_M_RD
+#include <linux/i2c-dev.h> 	// I2C bus definitions, I2C_RDWR
 #include <sys/ioctl.h>		// ioctl()
 #include <time.h>			// clock_gettime(), clock_nanosleep()
+// ALERT/RDY pin
+#include <poll.h>			// poll()
+#include <linux/gpio.h>		// GPIO_V2_GET_LINE_IOCTL, struct gpio_v2_line_event
 //**********************************************************************
+#ifdef __cplusplus
+extern "C" {
+#endif
 //DEFINE****************************************************************
 #define ADDRESS_SDA		0b1001010
 #define ADDRESS_SCL 	0b1001011
@@ -336,18 +350,442 @@ enum COMPARATOR_QUEUE_MASK {
 	QUEUE_DISABLED = CONFIG_REGISTER_COMPARATOR_QUEUE_DISABLED
  	};
 //**********************************************************************
+//**********************************************************************
+/* Status codes returned by the conversion functions. Conversions no
+ * longer block forever on a missing or hung chip; the wait gives up once
+ * the timeout set by ADS1115_set_timeout() has passed.  ADS1115_PENDING
+ * is not an error, ADS1115_poll_single_raw() returns it while the
+ * conversion is still running.
+ * 
+ * The datasheet specifies the internal oscillator, and therefore the
+ * data rate, to within 10 %.  Once the first "done" poll has passed the
+ * conversion wait polls the bus every period / ADS1115_POLL_DIVIDER.
+ * */
+#define ADS1115_DEFAULT_TIMEOUT_MS				250
+#define ADS1115_OSCILLATOR_TOLERANCE_PERCENT	10
+#define ADS1115_POLL_DIVIDER					20
+//**********************************************************************
+//**********************************************************************
+/* Oscillator drift - the oscillator, and every data rate with it, may be
+ * off by the tolerance above, so each handle learns its chip, for each
+ * RATE_MASK on its own.  A single shot is timed from the end of the config
+ * write to the result, which takes in bus time and the chip's wake-up
+ * besides the conversion; that latency sets where the first "done" poll
+ * goes: ADS1115_DRIFT_MARGIN_PERCENT past it rather than the full
+ * tolerance.
+ * Each conversion already done at that poll pulls the poll in by
+ * ADS1115_DRIFT_STEP_PPM until one is found still running; the time
+ * waited is then the latency and the margin starts over.  The first poll
+ * misses only now and then -- close to one poll per conversion.
+ * Latencies are averaged per rate; one further than
+ * ADS1115_DRIFT_OUTLIER_NS from the average is a late wake-up and
+ * dropped, unless ADS1115_DRIFT_OUTLIER_RUN come in a row, which starts
+ * the average over.
+ * The clock ratio (real conversion period over the nominal one, 1.0 to
+ * begin with) only comes from differences, where the fixed part cancels:
+ * between a latency and the average of a rate at least
+ * ADS1115_DRIFT_SPAN_NS of period apart, which also stands in for the
+ * rates not measured yet, and between ALERT/RDY edges of a continuous
+ * stream.  Both are fed in with weight 1/ADS1115_DRIFT_EDGE_WEIGHT, the
+ * first few single shot pairs as a plain mean.  Continuous reads are
+ * paced at the learned period, never below the nominal one less the
+ * tolerance; until the current rate has been measured, at the slowest
+ * period the tolerance allows, and each read a whole such period after
+ * the end of the one before.  The first read waits the single shot
+ * latency and then period / ADS1115_DRIFT_GUARD_DIVIDER more, so every
+ * read lands that far into the conversion after the one it returns, away
+ * from both ends; one that ends more than half of that past its time is
+ * taken to have passed over the conversion it was due in.
+ * A continuous stream never returns one conversion twice for a chip up
+ * to ADS1115_OSCILLATOR_TOLERANCE_PERCENT slow, measured or not.  Skipped
+ * conversions are counted exactly only once the rate is measured; before
+ * that a chip faster than the slowest period passes over conversions
+ * that are not counted, as many as it is faster.
+ * ADS1115_read_samples() stamps each sample with the time its conversion
+ * is estimated to have finished instead of the time it was read.
+ * */
+#define ADS1115_DRIFT_MARGIN_PERCENT	2
+#define ADS1115_DRIFT_STEP_PPM			1000
+#define ADS1115_DRIFT_EDGE_WEIGHT		16
+#define ADS1115_DRIFT_EDGE_PERIODS		4			// longest edge gap still measured
+#define ADS1115_DRIFT_SPAN_NS			20000000	// shorter gaps drown in timer jitter
+#define ADS1115_DRIFT_OUTLIER_NS		1000000
+#define ADS1115_DRIFT_OUTLIER_RUN		3
+#define ADS1115_DRIFT_GUARD_DIVIDER		2
+
+enum ADS1115_STATUS {
+	ADS1115_PENDING = 1,
+	ADS1115_OK = 0,
+	ADS1115_ERROR_IO = -1,
+	ADS1115_ERROR_TIMEOUT = -2,
+	ADS1115_ERROR_INVALID = -3
+	};
+//**********************************************************************
+//**********************************************************************
+/* Tracing - diagnostics are routed through ADS1115_TRACE() to a sink set
+ * with ADS1115_set_trace_sink().  Tracing is silent until a sink level is
+ * set.  Building with -DADS1115_TRACE_COMPILED_LEVEL=ADS1115_TRACE_NONE
+ * removes every trace call at compile time; the default keeps everything
+ * up to ADS1115_TRACE_DEBUG, which is the level used on the data path.
+ * */
+#define ADS1115_TRACE_MESSAGE_MAX	128
+
+enum ADS1115_TRACE_LEVEL {
+	ADS1115_TRACE_NONE = -1,
+	ADS1115_TRACE_ERROR = 0,
+	ADS1115_TRACE_WARNING = 1,
+	ADS1115_TRACE_INFO = 2,
+	ADS1115_TRACE_DEBUG = 3
+	};
+
+#ifndef ADS1115_TRACE_COMPILED_LEVEL
+#define ADS1115_TRACE_COMPILED_LEVEL	ADS1115_TRACE_DEBUG
+#endif
+
+typedef void (*ads1115_trace_sink)(enum ADS1115_TRACE_LEVEL level, const char *message, void *context);
+
+extern int i_ADS1115_trace_level;
+
+#define ADS1115_TRACE(level, ...) \
+	do { \
+		if ((level) <= ADS1115_TRACE_COMPILED_LEVEL && (level) <= i_ADS1115_trace_level) { \
+			ADS1115_trace((level), __VA_ARGS__); \
+			} \
+		} while (0)
+//**********************************************************************
+//**********************************************************************
+/* Adaptive data rate - with ADS1115_set_adaptive_rate() on, the data rate
+ * of each channel follows how fast its signal moves: the single channel
+ * setup read by ADS1115_read_samples() and every scan list entry keep a
+ * rate of their own.  A change between two samples of at least the busy
+ * threshold jumps straight to the fastest rate, so a transient is not
+ * missed; ADS1115_ADAPTIVE_QUIET_SAMPLES changes in a row below the quiet
+ * threshold step one RATE_MASK slower, down to the slowest rate.  Changes
+ * in between hold the rate.  One step slower at most doubles the change
+ * per sample, so with the busy threshold at least twice the quiet one a
+ * steady slope settles on a rate instead of bouncing between two.  Quiet
+ * channels then convert slowly, with less noise and fewer transactions,
+ * and leave the bus to the busy ones.  Every sample carries the rate it
+ * was converted with.  Codes converted at different PGA settings are not
+ * compared.  The raw and volt returning reads do not adapt.
+ * */
+#define ADS1115_ADAPTIVE_QUIET_SAMPLES	8
+#define ADS1115_ADAPTIVE_QUIET_CODES	4		// defaults, see ADS1115_set_adaptive_thresholds()
+#define ADS1115_ADAPTIVE_BUSY_CODES		64
+
+typedef struct ads1115_adaptive_state {
+	int16_t i16_last_code;
+	uint8_t ui8_last_pga_mask;
+	uint8_t ui8_quiet_count;
+	uint8_t ui8_valid;					// cleared until the first code of the channel
+	} ads1115_adaptive_state;
+//**********************************************************************
+//**********************************************************************
+/* Scan list - a sequence of (MULT_MASK, PGA_MASK, RATE_MASK) entries
+ * registered with ADS1115_scan_add() and converted in order by
+ * ADS1115_scan_sweep().  The next entry is started as soon as the
+ * previous conversion finishes, in the transaction that reads its result
+ * back.  With an
+ * adaptive rate an entry's RATE_MASK may change after its conversion;
+ * ADS1115_scan_sweep_samples() tags each result with the rate it was
+ * converted at.
+ * */
+#define ADS1115_SCAN_LIST_MAX	8
+
+// codes ADS1115_read_stream() reads per raw batch before converting to volts
+#define ADS1115_STREAM_CHUNK	64
+
+// largest device count ADS1115_read_conversion_batch() sends as one I2C_RDWR call
+#define ADS1115_BATCH_MAX		(I2C_RDWR_IOCTL_MAX_MSGS / 2)
+
+// chips on one bus ADS1115_read_samples_staggered() converts side by side, one per ADS1115_ADDRESS
+#define ADS1115_STAGGER_MAX		4
+
+typedef struct ads1115_scan_entry {
+	uint8_t ui8_mult_mask;
+	uint8_t ui8_pga_mask;
+	uint8_t ui8_rate_mask;				// rate of the next conversion
+	uint8_t ui8_converted_rate_mask;	// rate of the last one
+	float f_resolution;
+	ads1115_adaptive_state adaptive;
+	uint64_t ui64_ready_ns;				// when the entry's last conversion finished
+	} ads1115_scan_entry;
+//**********************************************************************
+//**********************************************************************
+/* Sample record - a raw conversion code tagged with the CLOCK_MONOTONIC
+ * time it was read, the masks it was converted with and the chip it came
+ * from.  The sequence number counts up per device handle, so a gap shows
+ * a sample lost on the way.  Used wherever samples are queued or stored
+ * instead of handed straight back.
+ * */
+typedef struct ads1115_sample {
+	uint64_t ui64_timestamp_ns;
+	uint32_t ui32_sequence;
+	int16_t i16_code;
+	uint8_t ui8_mult_mask;
+	uint8_t ui8_pga_mask;
+	uint8_t ui8_rate_mask;
+	uint8_t ui8_bus_id;
+	uint8_t ui8_address;
+	} ads1115_sample;
+
+// alignment that keeps fields written by different threads or processes apart
+#define ADS1115_CACHE_LINE		64
+//**********************************************************************
+//**********************************************************************
+/* Auto-range - with ADS1115_set_autorange() on, ADS1115_read_samples()
+ * and the volt returning reads pick the PGA from the last code.  A code
+ * at or beyond ADS1115_AUTORANGE_HIGH_PERCENT of full scale moves to a
+ * wider range, a narrower range is only taken when the value lands below
+ * ADS1115_AUTORANGE_LOW_PERCENT of its full scale; the gap between the
+ * two is the hysteresis.  The new range is chosen straight from the
+ * value, so one switch reaches it.  A switch in single shot mode applies
+ * to the next conversion and costs nothing, in continuous mode the
+ * conversion in flight is lost.  A clipped code says nothing about the
+ * value, it is discarded and converted again at PGA_6_144.  Every sample
+ * carries the PGA it was converted with.  Scan lists keep their own PGA.
+ * */
+#define ADS1115_AUTORANGE_HIGH_PERCENT	95
+#define ADS1115_AUTORANGE_LOW_PERCENT	70
+//**********************************************************************
+//**********************************************************************
+/* Alert - the comparator drives ALERT/RDY once a conversion crosses the
+ * Lo_thresh/Hi_thresh registers (set with ADS1115_set_thresholds()) for
+ * the number of conversions the COMPARATOR_QUEUE_MASK asks for.  Wire the
+ * open drain pin, with a pull-up, to a GPIO and open it with
+ * ADS1115_open_alert_gpio() after the polarity is set, or hand any
+ * pollable fd that becomes readable on an alert, such as the eventfd of
+ * the simulator, to ADS1115_set_alert_fd().  ADS1115_wait_alert() sleeps
+ * in poll() until the pin fires, so idle alarm channels cost neither CPU
+ * nor bus time.  Thresholds set with ADS1115_set_thresholds() stay in
+ * volts: whenever the PGA changes, by ADS1115_set_pga() or by auto-range,
+ * they are written again at the new range along with the config of the
+ * next conversion.  ADS1115_set_thresholds_raw() sets codes, which keep
+ * their value whatever the PGA.  Scan entries with a PGA of their own
+ * leave the thresholds where the handle's PGA put them.
+ *
+ * ADS1115_set_ready_mode() turns the pin into a conversion-ready signal
+ * instead: Hi_thresh MSB set, Lo_thresh MSB clear, comparator enabled.
+ * With an alert fd attached, single shot and continuous reads then wait
+ * for the RDY edge and read the conversion register once, with no
+ * config register polls on the bus.  Ready mode takes over the threshold
+ * registers and the comparator queue; turning it off writes back what
+ * they held when it was turned on.  Without an alert fd the reads fall
+ * back to polling.
+ * */
+#define ADS1115_ALERT_CONSUMER		"ads1115"
+
+// edge events drained per ADS1115_wait_alert() wakeup
+#define ADS1115_ALERT_EVENTS		16
+//**********************************************************************
+//**********************************************************************
+/* Statistics - always-on counters kept per device handle, updated by the
+ * thread that owns the handle and readable from any other thread with
+ * ADS1115_get_stats() while acquisition runs.  Each counter is stored
+ * whole, so a snapshot never holds a torn value, but the counters of one
+ * snapshot are not taken at a single instant.  Counters only grow, diff
+ * two snapshots for rates.  A transaction sent for several chips at once
+ * is counted on the first of them.
+ *
+ * The latency histogram counts conversions by the time from the start of
+ * the conversion (the single shot config write) to the result in hand;
+ * in continuous mode from the start of the wait for a sample.  Bucket n
+ * holds latencies of 2^n up to 2^(n+1) microseconds, the first bucket
+ * everything shorter, the last everything longer.
+ *
+ * ui64_skipped counts the continuous conversions late reads passed over,
+ * exact once the clock of the rate has been measured (see Oscillator
+ * drift); an unmeasured chip faster than the slowest period loses more.
+ * */
+#define ADS1115_LATENCY_BUCKETS		24
+
+typedef struct ads1115_stats {
+	uint64_t ui64_transfers;			// transport transactions
+	uint64_t ui64_messages;				// I2C messages within them
+	uint64_t ui64_bytes;				// data bytes, address bytes not counted
+	uint64_t ui64_errors;				// failed transactions
+	uint64_t ui64_retries;				// conversions repeated, e.g. autorange discards
+	uint64_t ui64_polls;				// "done" bit polls
+	uint64_t ui64_timeouts;				// conversions that never finished
+	uint64_t ui64_skipped;				// continuous conversions a late read passed over
+	uint64_t ui64_conversions;			// results read back
+	uint64_t ui64_latency_total_ns;
+	uint64_t ui64_latency_max_ns;
+	uint64_t ui64arr_latency[ADS1115_LATENCY_BUCKETS];
+	} ads1115_stats;
+
+// the owning thread is the only writer, a plain add with an untorn store is enough
+#define ADS1115_STAT_ADD(dev, field, n) \
+	__atomic_store_n(&(dev)->stats.field, (dev)->stats.field + (n), __ATOMIC_RELAXED)
+//**********************************************************************
+//**********************************************************************
+/* Shadow registers - the handle keeps a copy of the pointer, config and
+ * threshold registers as last written.  A pointer byte is only sent when
+ * the pointer has to move, and a register write is skipped when the chip
+ * already holds the value.  Single shot config writes are always sent
+ * since the write itself starts the conversion.
+ * */
+#define ADS1115_SHADOW_UNKNOWN	0xFF
+//**********************************************************************
+//**********************************************************************
+/* Transport - how a device handle reaches the chip.  transfer() carries
+ * out a list of I2C messages as one combined transaction (pointer and
+ * register writes, 2 byte reads) and returns an ADS1115_STATUS; close()
+ * releases the context when the device is closed.  ADS1115_init() uses
+ * the Linux i2c-dev backend on /dev/i2c-N, which
+ * ADS1115_linux_get_transport() opens on its own for callers that wrap
+ * it; ADS1115_init_transport() takes any other backend, e.g. the
+ * simulator in ads1115_sim.h.
+ * */
+typedef struct ads1115_transport {
+	int (*transfer)(void *context, struct i2c_msg *msgs, int count);
+	void (*close)(void *context);
+	void *context;
+	} ads1115_transport;
+//**********************************************************************
+//**********************************************************************
+/* Device handle - one per chip, created by ADS1115_init() and released
+ * by ADS1115_close().  Holds the transport, the config register
+ * masks and the scratch buffers that used to be file-scope globals, so any
+ * number of chips on any number of /dev/i2c-N buses can be driven from one
+ * process.  Handles are independent; a single handle must not be used by
+ * two threads at the same time.
+ * */
+typedef struct ads1115_dev {
+	ads1115_transport transport;
+	int i_bus_id;
+	uint8_t ui8_address;
+	
+	// config masks
+	uint8_t ui8_config_register_operation_mask;
+	uint8_t ui8_config_register_mult_mask;
+	uint8_t ui8_config_register_pga_mask;
+	uint8_t ui8_config_register_conversion_mode_mask;
+	uint8_t ui8_config_register_conversion_rate_mask;
+	uint8_t ui8_config_register_comparator_mode_mask;
+	uint8_t ui8_config_register_comparator_polarity_mask;
+	uint8_t ui8_config_register_comparator_latch_mask;
+	uint8_t ui8_config_register_comparator_queue_mask;
+	
+	uint8_t ui8arr_write_buffer[3];
+	uint8_t ui8arr_read_buffer[2];
+	
+	float f_resolution;
+	
+	// PGA follows the signal, see ADS1115_set_autorange()
+	uint8_t ui8_autorange;
+	
+	// data rate follows the signal, see ADS1115_set_adaptive_rate()
+	uint8_t ui8_adaptive_rate;
+	uint8_t ui8_adaptive_slowest;
+	uint8_t ui8_adaptive_fastest;
+	int16_t i16_adaptive_quiet;
+	int16_t i16_adaptive_busy;
+	ads1115_adaptive_state adaptive;
+	
+	// ALERT/RDY pin, see ADS1115_wait_alert() -- closed with the handle when owned
+	int i_alert_fd;
+	uint8_t ui8_alert_owned;
+	uint8_t ui8_ready_mode;
+	int16_t i16_threshold_low;			// as last written, the chip's power-on values to begin with
+	int16_t i16_threshold_high;
+	uint8_t ui8_thresholds_volts;		// set with ADS1115_set_thresholds(), follow the PGA
+	double d_threshold_low_volts;
+	double d_threshold_high_volts;
+	uint8_t ui8arr_threshold_buffer[2][3];
+	uint8_t ui8_ready_saved_queue_mask;	// comparator setup ready mode took over, given back when it ends
+	int16_t i16_ready_saved_low;
+	int16_t i16_ready_saved_high;
+	
+	// conversion wait deadline in ms, see ADS1115_set_timeout()
+	int i_timeout_ms;
+	
+	// learned timing per RATE_MASK and when the last conversion finished, see ADS1115_get_clock_ratio()
+	double d_clock_ratio;				// the oscillator, for rates not measured on their own
+	double darr_clock_ratio[8];			// 0 until measured
+	long larr_single_ns[8];				// single shot config write to result, 0 until timed
+	uint16_t ui16arr_single_count[8];	// latencies blended into larr_single_ns
+	uint8_t ui8arr_single_outliers[8];	// latencies dropped in a row
+	uint16_t ui16_drift_pairs;			// rate pairs blended into d_clock_ratio
+	double darr_poll_margin[8];			// first poll past the latency, as a fraction of it
+	uint64_t ui64_ready_ns;
+	uint64_t ui64_alert_ns;				// time of the last ALERT/RDY edge
+	
+	// shadow copies of what the chip holds, see ADS1115_write_register()
+	uint8_t ui8_pointer_shadow;
+	uint8_t ui8_register_shadow_valid;			// bit per POINTER_MASK
+	uint16_t ui16arr_register_shadow[4];		// indexed by POINTER_MASK
+	
+	// continuous mode state -- cleared whenever the config register must be rewritten
+	uint8_t ui8_continuous_configured;
+	struct timespec ts_next_sample;
+	
+	// scan list, see ADS1115_scan_add()
+	ads1115_scan_entry scan_list[ADS1115_SCAN_LIST_MAX];
+	int i_scan_count;
+	
+	// sequence number of the next ads1115_sample from this handle
+	uint32_t ui32_sequence;
+	
+	// counters and latency histogram, see ADS1115_get_stats()
+	ads1115_stats stats;
+	} ads1115_dev;
+//**********************************************************************
 //PROTOTYPE*************************************************************
-void ADS1115_init(int id, enum ADS1115_ADDRESS addr);
-void ADS1115_close();
-void ADS1115_set_conversion_rate(enum RATE_MASK sps);
-void ADS1115_set_conversion_mode(enum CONVERSION_MODE_MASK mode);
-void ADS1115_set_multiplex(enum MULT_MASK mult);
-void ADS1115_set_comparator_mode(enum COMPARATOR_MODE_MASK cmm);
-void ADS1115_set_comparator_polarity(enum COMPARATOR_POLARITY_MASK cpm);
-void ADS1115_set_comparator_latch(enum COMPARATOR_LATCH_MASK clm);
-void ADS1115_set_comparator_queue(enum COMPARATOR_QUEUE_MASK queue);
-void ADS1115_set_pga(enum PGA_MASK pga);
-double ADS1115_get_single_conversion();
-double ADS1115_get_average_conversions(int count);
-int ADS1115_read_stream(double *darr_buffer, int count);
+void ADS1115_set_trace_sink(ads1115_trace_sink sink, void *context, enum ADS1115_TRACE_LEVEL level);
+void ADS1115_trace(enum ADS1115_TRACE_LEVEL level, const char *format, ...);
+ads1115_dev *ADS1115_init(int id, enum ADS1115_ADDRESS addr);
+ads1115_dev *ADS1115_init_transport(const ads1115_transport *transport, int id, enum ADS1115_ADDRESS addr);
+int ADS1115_linux_get_transport(int id, enum ADS1115_ADDRESS addr, ads1115_transport *transport);
+void ADS1115_close(ads1115_dev *dev);
+int ADS1115_set_pointer_register(ads1115_dev *dev, enum POINTER_MASK mode);
+void ADS1115_set_conversion_rate(ads1115_dev *dev, enum RATE_MASK sps);
+void ADS1115_set_conversion_mode(ads1115_dev *dev, enum CONVERSION_MODE_MASK mode);
+void ADS1115_set_multiplex(ads1115_dev *dev, enum MULT_MASK mult);
+void ADS1115_set_comparator_mode(ads1115_dev *dev, enum COMPARATOR_MODE_MASK cmm);
+void ADS1115_set_comparator_polarity(ads1115_dev *dev, enum COMPARATOR_POLARITY_MASK cpm);
+void ADS1115_set_comparator_latch(ads1115_dev *dev, enum COMPARATOR_LATCH_MASK clm);
+void ADS1115_set_comparator_queue(ads1115_dev *dev, enum COMPARATOR_QUEUE_MASK queue);
+void ADS1115_set_pga(ads1115_dev *dev, enum PGA_MASK pga);
+void ADS1115_set_config_word(ads1115_dev *dev, uint16_t ui16_config);
+void ADS1115_set_timeout(ads1115_dev *dev, int ms);
+void ADS1115_set_autorange(ads1115_dev *dev, int i_enable);
+void ADS1115_set_adaptive_rate(ads1115_dev *dev, int i_enable);
+int ADS1115_set_adaptive_thresholds(ads1115_dev *dev, enum RATE_MASK slowest, enum RATE_MASK fastest, int16_t i16_quiet_codes, int16_t i16_busy_codes);
+uint64_t ADS1115_timespec_to_ns(const struct timespec *ts);
+uint64_t ADS1115_get_timestamp_ns();
+long ADS1115_get_rate_period_ns(uint8_t ui8_rate_mask);
+long ADS1115_get_conversion_period_ns(ads1115_dev *dev);
+double ADS1115_get_clock_ratio(ads1115_dev *dev);
+long ADS1115_get_sample_period_ns(ads1115_dev *dev);
+int ADS1115_start_single_raw(ads1115_dev *dev);
+int ADS1115_poll_single_raw(ads1115_dev *dev, int16_t *i16_code);
+int ADS1115_get_single_raw(ads1115_dev *dev, int16_t *i16_code);
+int ADS1115_get_single_conversion(ads1115_dev *dev, double *d_conversion);
+int ADS1115_get_average_conversions(ads1115_dev *dev, int count, double *d_average);
+int ADS1115_read_stream_raw(ads1115_dev *dev, int16_t *i16arr_buffer, int count);
+int ADS1115_read_stream(ads1115_dev *dev, double *darr_buffer, int count);
+int ADS1115_read_samples(ads1115_dev *dev, ads1115_sample *samples, int count);
+double ADS1115_sample_to_volts(const ads1115_sample *sample);
+void ADS1115_codes_to_volts(const int16_t *i16arr_codes, float *farr_volts, int count, enum PGA_MASK pga);
+void ADS1115_codes_to_volts_double(const int16_t *i16arr_codes, double *darr_volts, int count, enum PGA_MASK pga);
+void ADS1115_scan_clear(ads1115_dev *dev);
+int ADS1115_scan_add(ads1115_dev *dev, enum MULT_MASK mult, enum PGA_MASK pga, enum RATE_MASK sps);
+int ADS1115_scan_sweep_raw(ads1115_dev *dev, int16_t *i16arr_results);
+int ADS1115_scan_sweep(ads1115_dev *dev, double *darr_results);
+int ADS1115_scan_sweep_samples(ads1115_dev *dev, ads1115_sample *samples);
+int ADS1115_read_conversion_batch(ads1115_dev **devs, int count, double *darr_results);
+int ADS1115_read_samples_staggered(ads1115_dev **devs, int count, ads1115_sample *samples);
+int ADS1115_set_thresholds_raw(ads1115_dev *dev, int16_t i16_low, int16_t i16_high);
+int ADS1115_set_thresholds(ads1115_dev *dev, double d_low_volts, double d_high_volts);
+int ADS1115_open_alert_gpio(ads1115_dev *dev, const char *cp_chip, int i_line);
+void ADS1115_set_alert_fd(ads1115_dev *dev, int fd);
+int ADS1115_set_ready_mode(ads1115_dev *dev, int i_enable);
+int ADS1115_wait_alert(ads1115_dev *dev, int i_timeout_ms, int16_t *i16_code);
+void ADS1115_get_stats(ads1115_dev *dev, ads1115_stats *stats);
+uint64_t ADS1115_stats_latency_percentile_ns(const ads1115_stats *stats, double d_percentile);
 //**********************************************************************
+#ifdef __cplusplus
+}
+#endif
+#endif
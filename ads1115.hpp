@@ -0,0 +1,261 @@
+/* File:		ads1115.hpp
+ * Purpose: 	header-only C++ layer over ads1115.h with the device setup
+ * 				fixed at compile time
+ *
+ * Preface:		ads1115.hpp - a device configuration is a type,
+ * 				ads1115::config<...>, built from scoped enums that cannot
+ * 				be mixed up with one another. Its 16 bit config register
+ * 				word, volts per LSB and conversion period are constexpr, so
+ * 				they are computed by the compiler and nothing is assembled
+ * 				at run time. Settings that contradict each other, such as
+ * 				comparator options with the comparator disabled, fail the
+ * 				build through static_assert.
+ *
+ * 				ads1115::device<Config> owns one ads1115_dev: the
+ * 				constructor opens it and loads the whole config word in
+ * 				one call, the destructor closes it. Devices move but do not
+ * 				copy. Like the C API, errors come back as ADS1115_STATUS
+ * 				codes and a device that failed to open tests false; no
+ * 				exceptions are thrown. get() hands out the raw handle for
+ * 				everything the wrapper does not cover.
+ *
+ * 				using probe = ads1115::config<ads1115::mux::ain0, ads1115::pga::fsr_4_096,
+ * 					ads1115::rate::sps_860>;
+ * 				static_assert(probe::word == 0x43E3, "");
+ * 				ads1115::device<probe> adc(1, ads1115::address::gnd);
+ * 				double d_volts;
+ * 				if (adc && adc.read(d_volts) == ADS1115_OK) ...
+ *
+ * 				Needs C++14.
+ * */
+#ifndef ADS1115_HPP
+#define ADS1115_HPP
+
+//IMPORT****************************************************************
+#include "ads1115.h"
+#include <cstdint>			// uint16_t, ect.
+#include <utility>			// std::exchange()
+//**********************************************************************
+//DEFINE****************************************************************
+namespace ads1115 {
+
+enum class address : uint8_t {
+	gnd = ADDRESS_GND,
+	vdd = ADDRESS_VDD,
+	sda = ADDRESS_SDA,
+	scl = ADDRESS_SCL
+	};
+
+enum class mux : uint8_t {
+	ain0_ain1 = CONFIG_REGISTER_MULT_AIN_0_AND_1_DIFFERENTIAL,
+	ain0_ain3 = CONFIG_REGISTER_MULT_AIN_0_AND_3_DIFFERENTIAL,
+	ain1_ain3 = CONFIG_REGISTER_MULT_AIN_1_AND_3_DIFFERENTIAL,
+	ain2_ain3 = CONFIG_REGISTER_MULT_AIN_2_AND_3_DIFFERENTIAL,
+	ain0 = CONFIG_REGISTER_MULT_AIN_0,
+	ain1 = CONFIG_REGISTER_MULT_AIN_1,
+	ain2 = CONFIG_REGISTER_MULT_AIN_2,
+	ain3 = CONFIG_REGISTER_MULT_AIN_3
+	};
+
+enum class pga : uint8_t {
+	fsr_6_144 = CONFIG_REGISTER_PGA_6_144,
+	fsr_4_096 = CONFIG_REGISTER_PGA_4_096,
+	fsr_2_048 = CONFIG_REGISTER_PGA_2_048,
+	fsr_1_024 = CONFIG_REGISTER_PGA_1_024,
+	fsr_0_512 = CONFIG_REGISTER_PGA_0_512,
+	fsr_0_256 = CONFIG_REGISTER_PGA_0_256
+	};
+
+enum class mode : uint8_t {
+	continuous = CONFIG_REGISTER_CONTINUOUS_CONVERSION,
+	single = CONFIG_REGISTER_SINGLE_CONVERSION
+	};
+
+enum class rate : uint8_t {
+	sps_8 = CONFIG_REGISTER_SPS_8,
+	sps_16 = CONFIG_REGISTER_SPS_16,
+	sps_32 = CONFIG_REGISTER_SPS_32,
+	sps_64 = CONFIG_REGISTER_SPS_64,
+	sps_128 = CONFIG_REGISTER_SPS_128,
+	sps_250 = CONFIG_REGISTER_SPS_250,
+	sps_475 = CONFIG_REGISTER_SPS_475,
+	sps_860 = CONFIG_REGISTER_SPS_860
+	};
+
+enum class comparator : uint8_t {
+	traditional = CONFIG_REGISTER_COMPARATOR_MODE_TRADITIONAL,
+	window = CONFIG_REGISTER_COMPARATOR_MODE_WINDOW
+	};
+
+enum class polarity : uint8_t {
+	active_low = CONFIG_REGISTER_COMPARATOR_POLARITY_LOW,
+	active_high = CONFIG_REGISTER_COMPARATOR_POLARITY_HIGH
+	};
+
+enum class latch : uint8_t {
+	non_latching = CONFIG_REGISTER_COMPARATOR_NON_LATCHING,
+	latching = CONFIG_REGISTER_COMPARATOR_LATCHING
+	};
+
+enum class queue : uint8_t {
+	assert_1 = CONFIG_REGISTER_COMPARATOR_QUEUE_LENGTH_1,
+	assert_2 = CONFIG_REGISTER_COMPARATOR_QUEUE_LENGTH_2,
+	assert_4 = CONFIG_REGISTER_COMPARATOR_QUEUE_LENGTH_4,
+	disabled = CONFIG_REGISTER_COMPARATOR_QUEUE_DISABLED
+	};
+
+// full scale range in volts, the table behind ADS1115_get_pga_range()
+constexpr double pga_range(pga p) {
+	return (p == pga::fsr_6_144) ? PGA_6_144V :
+		(p == pga::fsr_4_096) ? PGA_4_096V :
+		(p == pga::fsr_2_048) ? PGA_2_048V :
+		(p == pga::fsr_1_024) ? PGA_1_024V :
+		(p == pga::fsr_0_512) ? PGA_0_512V : PGA_0_256V;
+	}
+
+// data rate in samples per second, RATE_MASK bits 7:5 index the table
+constexpr int rate_sps(rate r) {
+	return (r == rate::sps_8) ? 8 :
+		(r == rate::sps_16) ? 16 :
+		(r == rate::sps_32) ? 32 :
+		(r == rate::sps_64) ? 64 :
+		(r == rate::sps_128) ? 128 :
+		(r == rate::sps_250) ? 250 :
+		(r == rate::sps_475) ? 475 : 860;
+	}
+
+/* Compile time device configuration - the defaults are the power-on
+ * defaults of the library (see ADS1115_init_transport()).
+ * */
+template <mux Mux = mux::ain0,
+	pga Pga = pga::fsr_4_096,
+	rate Rate = rate::sps_32,
+	mode Mode = mode::single,
+	comparator Comparator = comparator::traditional,
+	polarity Polarity = polarity::active_low,
+	latch Latch = latch::non_latching,
+	queue Queue = queue::disabled>
+struct config {
+	static_assert(Queue != queue::disabled ||
+		(Comparator == comparator::traditional && Polarity == polarity::active_low && Latch == latch::non_latching),
+		"comparator mode, polarity and latch have no effect with the comparator queue disabled");
+
+	static constexpr mux multiplex = Mux;
+	static constexpr pga gain = Pga;
+	static constexpr rate data_rate = Rate;
+	static constexpr mode conversion_mode = Mode;
+
+	// config register as ADS1115_set_config_word() takes it, OS bit clear
+	static constexpr uint16_t word = static_cast<uint16_t>(
+		(static_cast<unsigned>(Mux) | static_cast<unsigned>(Pga) | static_cast<unsigned>(Mode)) << 8 |
+		static_cast<unsigned>(Rate) | static_cast<unsigned>(Comparator) | static_cast<unsigned>(Polarity) |
+		static_cast<unsigned>(Latch) | static_cast<unsigned>(Queue));
+
+	static constexpr double volts_per_lsb = pga_range(Pga) / 32768.0;
+	// nominal, the reads wait for the learned period, see ADS1115_get_clock_ratio()
+	static constexpr long period_ns = 1000000000L / rate_sps(Rate);
+
+	static constexpr double to_volts(int16_t i16_code) {
+		return i16_code * volts_per_lsb;
+		}
+	};
+
+/* RAII device handle - one chip converting with Config. Reads follow the
+ * conversion mode of the configuration: single shot conversions, or
+ * paced reads of the continuous stream.
+ * */
+template <typename Config>
+class device {
+public:
+	using config_type = Config;
+
+	device(int i_bus_id, address addr)
+		: dev(ADS1115_init(i_bus_id, static_cast<ADS1115_ADDRESS>(addr))) {
+		apply();
+		}
+
+	// any other transport, e.g. the simulator in ads1115_sim.h
+	device(const ads1115_transport &transport, int i_bus_id, address addr)
+		: dev(ADS1115_init_transport(&transport, i_bus_id, static_cast<ADS1115_ADDRESS>(addr))) {
+		apply();
+		}
+
+	// adopt a handle already opened, e.g. by ADS1115_sim_init()
+	explicit device(ads1115_dev *handle)
+		: dev(handle) {
+		apply();
+		}
+
+	~device() {
+		if (dev != nullptr) {
+			ADS1115_close(dev);
+			}
+		}
+
+	device(const device &) = delete;
+	device &operator=(const device &) = delete;
+
+	device(device &&other) noexcept
+		: dev(std::exchange(other.dev, nullptr)) {
+		}
+
+	device &operator=(device &&other) noexcept {
+		if (this != &other) {
+			if (dev != nullptr) {
+				ADS1115_close(dev);
+				}
+			dev = std::exchange(other.dev, nullptr);
+			}
+		return *this;
+		}
+
+	explicit operator bool() const {
+		return dev != nullptr;
+		}
+
+	ads1115_dev *get() const {
+		return dev;
+		}
+
+	int read_raw(int16_t &i16_code) {
+		if (Config::conversion_mode == mode::single) {
+			return ADS1115_get_single_raw(dev, &i16_code);
+			}
+		int i_read = ADS1115_read_stream_raw(dev, &i16_code, 1);
+		return (i_read == 1) ? ADS1115_OK : i_read;
+		}
+
+	int read(double &d_volts) {
+		int16_t i16_code;
+		int i_status = read_raw(i16_code);
+		if (i_status == ADS1115_OK) {
+			d_volts = Config::to_volts(i16_code);
+			}
+		return i_status;
+		}
+
+	int read_stream_raw(int16_t *i16arr_buffer, int count) {
+		return ADS1115_read_stream_raw(dev, i16arr_buffer, count);
+		}
+
+	int read_samples(ads1115_sample *samples, int count) {
+		return ADS1115_read_samples(dev, samples, count);
+		}
+
+	void get_stats(ads1115_stats &stats) const {
+		ADS1115_get_stats(dev, &stats);
+		}
+
+private:
+	void apply() {
+		if (dev != nullptr) {
+			ADS1115_set_config_word(dev, Config::word);
+			}
+		}
+
+	ads1115_dev *dev;
+	};
+
+}
+//**********************************************************************
+#endif
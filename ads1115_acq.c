@@ -0,0 +1,425 @@
+/* File:		ads1115_acq.c
+ * Purpose: 	background acquisition engine for ads1115.c
+ *
+ * Preface:		see ads1115_acq.h. CPU pinning and SCHED_FIFO are both
+ * 				optional; SCHED_FIFO normally needs CAP_SYS_NICE, and a
+ * 				failure to get it is traced and ignored rather than
+ * 				treated as fatal.
+ * */
+#define _GNU_SOURCE			// pthread_setaffinity_np(), CPU_SET()
+#include "ads1115_acq.h"
+#include "ads1115_internal.h"
+#include <sched.h>			// sched_param, SCHED_FIFO
+
+int ADS1115_ring_init(ads1115_ring *ring, uint32_t ui32_capacity) {
+	uint32_t ui32_size = 1;
+	while (ui32_size < ui32_capacity) {
+		ui32_size <<= 1;
+		}
+	ring->samples = calloc(ui32_size, sizeof(ads1115_sample));
+	if (ring->samples == NULL) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_ring_init - calloc: %s", strerror(errno));
+		return ADS1115_ERROR_INVALID;
+		}
+	ring->ui32_mask = ui32_size - 1;
+	atomic_init(&ring->ui32_head, 0);
+	atomic_init(&ring->ui32_tail, 0);
+	atomic_init(&ring->ui64_overruns, 0);
+	return ADS1115_OK;
+	}
+
+void ADS1115_ring_free(ads1115_ring *ring) {
+	free(ring->samples);
+	ring->samples = NULL;
+	}
+
+int ADS1115_ring_push(ads1115_ring *ring, const ads1115_sample *sample) {
+	// producer side -- only the producer writes the head
+	uint32_t ui32_head = atomic_load_explicit(&ring->ui32_head, memory_order_relaxed);
+	uint32_t ui32_tail = atomic_load_explicit(&ring->ui32_tail, memory_order_acquire);
+	if (ui32_head - ui32_tail > ring->ui32_mask) {
+		atomic_fetch_add_explicit(&ring->ui64_overruns, 1, memory_order_relaxed);
+		return 0;
+		}
+	ring->samples[ui32_head & ring->ui32_mask] = *sample;
+	atomic_store_explicit(&ring->ui32_head, ui32_head + 1, memory_order_release);
+	return 1;
+	}
+
+int ADS1115_ring_drain(ads1115_ring *ring, ads1115_sample *samples, int max) {
+	// consumer side -- only the consumer writes the tail
+	if (max <= 0) {
+		return 0;
+		}
+	uint32_t ui32_tail = atomic_load_explicit(&ring->ui32_tail, memory_order_relaxed);
+	uint32_t ui32_head = atomic_load_explicit(&ring->ui32_head, memory_order_acquire);
+	uint32_t ui32_available = ui32_head - ui32_tail;
+	if (ui32_available > (uint32_t)max) {
+		ui32_available = max;
+		}
+	for (uint32_t c = 0; c < ui32_available; c++) {
+		samples[c] = ring->samples[(ui32_tail + c) & ring->ui32_mask];
+		}
+	atomic_store_explicit(&ring->ui32_tail, ui32_tail + ui32_available, memory_order_release);
+	return ui32_available;
+	}
+
+int ADS1115_acq_read_device(ads1115_dev *dev, ads1115_sample *samples) {
+	// one pass over the device -- a scan list takes priority over the single channel setup
+	if (dev->i_scan_count == 0) {
+		return ADS1115_read_samples(dev, samples, 1);
+		}
+	return ADS1115_scan_sweep_samples(dev, samples);
+	}
+
+void ADS1115_acq_backoff() {
+	// back off before retrying the bus
+	struct timespec ts_wait = {0, ADS1115_ACQ_BACKOFF_NS};
+	nanosleep(&ts_wait, NULL);
+	}
+
+void *ADS1115_acq_alloc(size_t size) {
+	// zeroed and aligned for the cache line members, calloc() only promises max_align_t
+	size_t ui_size = (size + ADS1115_CACHE_LINE - 1) / ADS1115_CACHE_LINE * ADS1115_CACHE_LINE;
+	void *vp_memory = aligned_alloc(ADS1115_CACHE_LINE, ui_size);
+	if (vp_memory != NULL) {
+		memset(vp_memory, 0, ui_size);
+		}
+	return vp_memory;
+	}
+
+void *ADS1115_acq_thread(void *arg) {
+	ads1115_acq *acq = arg;
+	ads1115_sample samples[ADS1115_SCAN_LIST_MAX];
+
+	while (atomic_load_explicit(&acq->i_running, memory_order_relaxed)) {
+		int i_count = ADS1115_acq_read_device(acq->dev, samples);
+		if (i_count < 0) {
+			atomic_fetch_add_explicit(&acq->ui64_errors, 1, memory_order_relaxed);
+			ADS1115_acq_backoff();
+			continue;
+			}
+		for (int c = 0; c < i_count; c++) {
+			ADS1115_ring_push(&acq->ring, &samples[c]);
+			}
+		}
+	return NULL;
+	}
+
+int ADS1115_acq_spawn(pthread_t *thread, void *(*routine)(void *), void *arg, int i_cpu, int i_fifo_priority) {
+	pthread_attr_t attr;
+	pthread_attr_init(&attr);
+
+	// optional real-time scheduling, i_fifo_priority of 0 keeps the default
+	if (i_fifo_priority > 0) {
+		struct sched_param param = {0};
+		param.sched_priority = i_fifo_priority;
+		pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+		pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+		pthread_attr_setschedparam(&attr, &param);
+		}
+
+	int i_result = pthread_create(thread, &attr, routine, arg);
+	if (i_result != 0 && i_fifo_priority > 0) {
+		ADS1115_TRACE(ADS1115_TRACE_WARNING, "ADS1115_acq_spawn - SCHED_FIFO refused: %s", strerror(i_result));
+		pthread_attr_setinheritsched(&attr, PTHREAD_INHERIT_SCHED);
+		i_result = pthread_create(thread, &attr, routine, arg);
+		}
+	pthread_attr_destroy(&attr);
+	if (i_result != 0) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_acq_spawn - pthread_create: %s", strerror(i_result));
+		return ADS1115_ERROR_INVALID;
+		}
+
+	// optional CPU pinning, i_cpu of -1 leaves the thread unpinned
+	if (i_cpu >= 0) {
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		CPU_SET(i_cpu, &cpus);
+		i_result = pthread_setaffinity_np(*thread, sizeof(cpus), &cpus);
+		if (i_result != 0) {
+			ADS1115_TRACE(ADS1115_TRACE_WARNING, "ADS1115_acq_spawn - affinity: %s", strerror(i_result));
+			}
+		}
+	return ADS1115_OK;
+	}
+
+ads1115_acq *ADS1115_acq_create(ads1115_dev *dev, uint32_t ui32_capacity) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_acq_create");
+	ads1115_acq *acq = ADS1115_acq_alloc(sizeof(ads1115_acq));
+	if (acq == NULL) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_acq_create - aligned_alloc: %s", strerror(errno));
+		return NULL;
+		}
+	if (ADS1115_ring_init(&acq->ring, ui32_capacity) != ADS1115_OK) {
+		free(acq);
+		return NULL;
+		}
+	acq->dev = dev;
+	atomic_init(&acq->i_running, 0);
+	atomic_init(&acq->ui64_errors, 0);
+	return acq;
+	}
+
+int ADS1115_acq_start(ads1115_acq *acq, int i_cpu, int i_fifo_priority) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_acq_start");
+	atomic_store(&acq->i_running, 1);
+	int i_status = ADS1115_acq_spawn(&acq->thread, ADS1115_acq_thread, acq, i_cpu, i_fifo_priority);
+	if (i_status != ADS1115_OK) {
+		atomic_store(&acq->i_running, 0);
+		}
+	return i_status;
+	}
+
+void ADS1115_acq_stop(ads1115_acq *acq) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_acq_stop");
+	if (atomic_exchange(&acq->i_running, 0)) {
+		pthread_join(acq->thread, NULL);
+		}
+	}
+
+int ADS1115_acq_drain(ads1115_acq *acq, ads1115_sample *samples, int max) {
+	return ADS1115_ring_drain(&acq->ring, samples, max);
+	}
+
+uint64_t ADS1115_acq_get_overruns(ads1115_acq *acq) {
+	return atomic_load_explicit(&acq->ring.ui64_overruns, memory_order_relaxed);
+	}
+
+uint64_t ADS1115_acq_get_errors(ads1115_acq *acq) {
+	return atomic_load_explicit(&acq->ui64_errors, memory_order_relaxed);
+	}
+
+void ADS1115_acq_destroy(ads1115_acq *acq) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_acq_destroy");
+	ADS1115_acq_stop(acq);
+	ADS1115_ring_free(&acq->ring);
+	free(acq);
+	}
+
+uint64_t ADS1115_acq_lookback_ns(ads1115_acq_worker *worker) {
+	// how long before the start of a read its samples may be stamped -- a
+	// continuous read returns a conversion that ended up to a period earlier
+	long l_lookback_ns = 0;
+	for (int d = 0; d < worker->i_dev_count; d++) {
+		ads1115_dev *dev = worker->devs[d];
+		if (dev->i_scan_count > 0 || dev->ui8_config_register_conversion_mode_mask != CONTINUOUS) {
+			continue;
+			}
+		uint8_t ui8_rate_mask = dev->ui8_adaptive_rate ? dev->ui8_adaptive_slowest : dev->ui8_config_register_conversion_rate_mask;
+		long l_period_ns = ADS1115_get_rate_period_ns(ui8_rate_mask);
+		l_period_ns += l_period_ns / 100 * ADS1115_OSCILLATOR_TOLERANCE_PERCENT;
+		if (l_period_ns > l_lookback_ns) {
+			l_lookback_ns = l_period_ns;
+			}
+		}
+	return l_lookback_ns;
+	}
+
+void ADS1115_acq_hold(ads1115_acq_worker *worker, const ads1115_sample *samples, int count) {
+	// insert in stamp order, samples mostly arrive in order already
+	for (int c = 0; c < count; c++) {
+		if (worker->i_held == ADS1115_ACQ_HOLD) {
+			ADS1115_TRACE(ADS1115_TRACE_WARNING, "ADS1115_acq_hold - full on bus %d", worker->i_bus_id);
+			ADS1115_ring_push(&worker->ring, &worker->held[0]);
+			memmove(&worker->held[0], &worker->held[1], (--worker->i_held) * sizeof(ads1115_sample));
+			}
+		int i_slot = worker->i_held;
+		while (i_slot > 0 && worker->held[i_slot - 1].ui64_timestamp_ns > samples[c].ui64_timestamp_ns) {
+			worker->held[i_slot] = worker->held[i_slot - 1];
+			i_slot--;
+			}
+		worker->held[i_slot] = samples[c];
+		worker->i_held++;
+		}
+	}
+
+void ADS1115_acq_release(ads1115_acq_worker *worker, uint64_t ui64_watermark_ns) {
+	// push everything the watermark has passed, then publish it -- the merge
+	// then finds every sample up to the watermark in the ring already
+	int i_passed = 0;
+	while (i_passed < worker->i_held && worker->held[i_passed].ui64_timestamp_ns <= ui64_watermark_ns) {
+		ADS1115_ring_push(&worker->ring, &worker->held[i_passed++]);
+		}
+	worker->i_held -= i_passed;
+	memmove(&worker->held[0], &worker->held[i_passed], worker->i_held * sizeof(ads1115_sample));
+	atomic_store_explicit(&worker->ui64_watermark_ns, ui64_watermark_ns, memory_order_release);
+	}
+
+void *ADS1115_acq_group_thread(void *arg) {
+	// one bus, its devices read in turn or side by side
+	ads1115_acq_worker *worker = arg;
+	ads1115_acq_group *group = worker->group;
+	ads1115_sample samples[ADS1115_SCAN_LIST_MAX];
+
+	// plain single shot devices convert side by side, see ADS1115_read_samples_staggered()
+	int i_staggered = (worker->i_dev_count > 1);
+	for (int d = 0; d < worker->i_dev_count; d++) {
+		ads1115_dev *dev = worker->devs[d];
+		if (dev->i_scan_count > 0 || dev->ui8_config_register_conversion_mode_mask != SINGLE) {
+			i_staggered = 0;
+			}
+		}
+	uint64_t ui64_lookback_ns = ADS1115_acq_lookback_ns(worker);
+
+	while (atomic_load_explicit(&group->i_running, memory_order_relaxed)) {
+		if (i_staggered) {
+			ADS1115_acq_release(worker, ADS1115_get_timestamp_ns());
+			int i_count = ADS1115_read_samples_staggered(worker->devs, worker->i_dev_count, samples);
+			if (i_count < 0) {
+				atomic_fetch_add_explicit(&worker->ui64_errors, 1, memory_order_relaxed);
+				ADS1115_acq_backoff();
+				continue;
+				}
+			ADS1115_acq_hold(worker, samples, i_count);
+			continue;
+			}
+		for (int d = 0; d < worker->i_dev_count; d++) {
+			// whatever this bus reads from now on is stamped later than this
+			ADS1115_acq_release(worker, ADS1115_get_timestamp_ns() - ui64_lookback_ns);
+			int i_count = ADS1115_acq_read_device(worker->devs[d], samples);
+			if (i_count < 0) {
+				atomic_fetch_add_explicit(&worker->ui64_errors, 1, memory_order_relaxed);
+				ADS1115_acq_backoff();
+				continue;
+				}
+			ADS1115_acq_hold(worker, samples, i_count);
+			}
+		}
+	// nothing more is coming, let the merge release everything left
+	ADS1115_acq_release(worker, UINT64_MAX);
+	return NULL;
+	}
+
+ads1115_acq_group *ADS1115_acq_group_create(ads1115_dev **devs, int count, uint32_t ui32_capacity) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_acq_group_create");
+	ads1115_acq_group *group = ADS1115_acq_alloc(sizeof(ads1115_acq_group));
+	if (group == NULL) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_acq_group_create - aligned_alloc: %s", strerror(errno));
+		return NULL;
+		}
+	atomic_init(&group->i_running, 0);
+
+	// one worker per bus id, in order of first appearance
+	for (int c = 0; c < count; c++) {
+		ads1115_acq_worker *worker = NULL;
+		for (int w = 0; w < group->i_worker_count; w++) {
+			if (group->workers[w].i_bus_id == devs[c]->i_bus_id) {
+				worker = &group->workers[w];
+				}
+			}
+		if (worker == NULL) {
+			if (group->i_worker_count == ADS1115_ACQ_GROUP_BUSES) {
+				ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_acq_group_create - more than %d buses", ADS1115_ACQ_GROUP_BUSES);
+				ADS1115_acq_group_destroy(group);
+				return NULL;
+				}
+			worker = &group->workers[group->i_worker_count];
+			if (ADS1115_ring_init(&worker->ring, ui32_capacity) != ADS1115_OK) {
+				ADS1115_acq_group_destroy(group);
+				return NULL;
+				}
+			group->i_worker_count++;
+			worker->i_bus_id = devs[c]->i_bus_id;
+			worker->group = group;
+			atomic_init(&worker->ui64_watermark_ns, 0);
+			atomic_init(&worker->ui64_errors, 0);
+			}
+		if (worker->i_dev_count == ADS1115_ACQ_BUS_DEVICES) {
+			ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_acq_group_create - more than %d devices on bus %d", ADS1115_ACQ_BUS_DEVICES, worker->i_bus_id);
+			ADS1115_acq_group_destroy(group);
+			return NULL;
+			}
+		worker->devs[worker->i_dev_count++] = devs[c];
+		}
+	return group;
+	}
+
+int ADS1115_acq_group_start(ads1115_acq_group *group, const int *iarr_cpus, int i_fifo_priority) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_acq_group_start");
+	// iarr_cpus holds one CPU per bus in creation order, NULL leaves them all unpinned
+	atomic_store(&group->i_running, 1);
+	for (int w = 0; w < group->i_worker_count; w++) {
+		ads1115_acq_worker *worker = &group->workers[w];
+		int i_cpu = (iarr_cpus != NULL) ? iarr_cpus[w] : -1;
+		if (ADS1115_acq_spawn(&worker->thread, ADS1115_acq_group_thread, worker, i_cpu, i_fifo_priority) != ADS1115_OK) {
+			ADS1115_acq_group_stop(group);
+			return ADS1115_ERROR_INVALID;
+			}
+		worker->ui8_started = 1;
+		}
+	return ADS1115_OK;
+	}
+
+void ADS1115_acq_group_stop(ads1115_acq_group *group) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_acq_group_stop");
+	atomic_store(&group->i_running, 0);
+	for (int w = 0; w < group->i_worker_count; w++) {
+		ads1115_acq_worker *worker = &group->workers[w];
+		if (worker->ui8_started) {
+			pthread_join(worker->thread, NULL);
+			worker->ui8_started = 0;
+			}
+		atomic_store(&worker->ui64_watermark_ns, UINT64_MAX);
+		}
+	}
+
+int ADS1115_acq_group_drain(ads1115_acq_group *group, ads1115_sample *samples, int max) {
+	// a sample is released once no bus can still deliver an earlier one; the
+	// watermarks are read before the rings so nothing older can slip in behind
+	uint64_t ui64_limit_ns = UINT64_MAX;
+	for (int w = 0; w < group->i_worker_count; w++) {
+		uint64_t ui64_watermark_ns = atomic_load_explicit(&group->workers[w].ui64_watermark_ns, memory_order_acquire);
+		if (ui64_watermark_ns < ui64_limit_ns) {
+			ui64_limit_ns = ui64_watermark_ns;
+			}
+		}
+	for (int w = 0; w < group->i_worker_count; w++) {
+		ads1115_acq_worker *worker = &group->workers[w];
+		if (!worker->ui8_head_valid) {
+			worker->ui8_head_valid = ADS1115_ring_drain(&worker->ring, &worker->head, 1);
+			}
+		}
+
+	int i_total = 0;
+	while (i_total < max) {
+		ads1115_acq_worker *earliest = NULL;
+		for (int w = 0; w < group->i_worker_count; w++) {
+			ads1115_acq_worker *worker = &group->workers[w];
+			if (worker->ui8_head_valid && (earliest == NULL || worker->head.ui64_timestamp_ns < earliest->head.ui64_timestamp_ns)) {
+				earliest = worker;
+				}
+			}
+		if (earliest == NULL || earliest->head.ui64_timestamp_ns > ui64_limit_ns) {
+			break;
+			}
+		samples[i_total++] = earliest->head;
+		earliest->ui8_head_valid = ADS1115_ring_drain(&earliest->ring, &earliest->head, 1);
+		}
+	return i_total;
+	}
+
+uint64_t ADS1115_acq_group_get_overruns(ads1115_acq_group *group) {
+	uint64_t ui64_overruns = 0;
+	for (int w = 0; w < group->i_worker_count; w++) {
+		ui64_overruns += atomic_load_explicit(&group->workers[w].ring.ui64_overruns, memory_order_relaxed);
+		}
+	return ui64_overruns;
+	}
+
+uint64_t ADS1115_acq_group_get_errors(ads1115_acq_group *group) {
+	uint64_t ui64_errors = 0;
+	for (int w = 0; w < group->i_worker_count; w++) {
+		ui64_errors += atomic_load_explicit(&group->workers[w].ui64_errors, memory_order_relaxed);
+		}
+	return ui64_errors;
+	}
+
+void ADS1115_acq_group_destroy(ads1115_acq_group *group) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_acq_group_destroy");
+	ADS1115_acq_group_stop(group);
+	for (int w = 0; w < group->i_worker_count; w++) {
+		ADS1115_ring_free(&group->workers[w].ring);
+		}
+	free(group);
+	}
@@ -0,0 +1,137 @@
+/* File:		ads1115_acq.h
+ * Purpose: 	background acquisition engine for ads1115.c
+ *
+ * Preface:		ads1115_acq.h - runs the conversion loop of one ads1115_dev
+ * 				on its own thread and publishes timestamped samples into a
+ * 				lock-free single-producer/single-consumer ring buffer. The
+ * 				consumer drains samples in batches and never blocks on the
+ * 				I2C bus. When the ring is full new samples are dropped and
+ * 				counted as overruns.
+ *
+ * 				The thread converts the device's scan list when one is set,
+ * 				otherwise it reads with the device's current setup (single
+ * 				shot or continuous). The device handle belongs to the
+ * 				thread between ADS1115_acq_start() and ADS1115_acq_stop().
+ *
+ * 				An acquisition group spreads a set of devices over their
+ * 				buses: one worker thread per i_bus_id, optionally pinned to
+ * 				its own CPU, reads the devices of that bus into a ring of
+ * 				its own -- side by side when they are all plain single
+ * 				shot (see ADS1115_read_samples_staggered()), in turn
+ * 				otherwise. ADS1115_acq_group_drain() merges the rings
+ * 				into a single stream in timestamp order; each worker
+ * 				publishes a watermark before every read, the earliest
+ * 				stamp that read can produce, and a sample is only
+ * 				released once every bus has moved past it. Samples
+ * 				carry their bus, address and per-device sequence number.
+ * */
+#ifndef ADS1115_ACQ_H
+#define ADS1115_ACQ_H
+
+#include "ads1115.h"
+#include <pthread.h>		// pthread_create(), pthread_join()
+#ifndef __cplusplus
+#include <stdatomic.h>		// _Atomic, atomic_load_explicit(), ect.
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+//DEFINE****************************************************************
+#define ADS1115_ACQ_GROUP_BUSES		8
+#define ADS1115_ACQ_BUS_DEVICES		4		// one per ADS1115_ADDRESS
+
+// pause after a failed read before the bus is tried again, the slowest conversion period
+#define ADS1115_ACQ_BACKOFF_NS		(1000000000L / 8)
+
+/* Stamp order - a sample is stamped when its conversion ended, which for a
+ * continuous read is up to a period before the read started.  Each worker
+ * holds its samples back, in stamp order, until the watermark has passed
+ * them, so its ring never goes back in time.  The watermark is the start
+ * of the next read less the longest conversion period a continuous device
+ * on the bus can run at.  A full hold buffer passes its earliest sample
+ * on regardless.
+ * */
+#define ADS1115_ACQ_HOLD			256
+
+#ifndef __cplusplus
+/* SPSC ring buffer - capacity is rounded up to a power of two. Head and
+ * tail are free running counters on separate cache lines; the producer
+ * only writes the head, the consumer only writes the tail.
+ * */
+typedef struct ads1115_ring {
+	ads1115_sample *samples;
+	uint32_t ui32_mask;
+	_Alignas(ADS1115_CACHE_LINE) _Atomic uint32_t ui32_head;
+	_Alignas(ADS1115_CACHE_LINE) _Atomic uint32_t ui32_tail;
+	_Alignas(ADS1115_CACHE_LINE) _Atomic uint64_t ui64_overruns;
+	} ads1115_ring;
+
+typedef struct ads1115_acq {
+	ads1115_dev *dev;
+	ads1115_ring ring;
+	pthread_t thread;
+	_Atomic int i_running;
+	_Atomic uint64_t ui64_errors;
+	} ads1115_acq;
+
+struct ads1115_acq_group;
+
+typedef struct ads1115_acq_worker {
+	int i_bus_id;
+	ads1115_dev *devs[ADS1115_ACQ_BUS_DEVICES];
+	int i_dev_count;
+	ads1115_ring ring;
+	pthread_t thread;
+	uint8_t ui8_started;
+	struct ads1115_acq_group *group;
+	_Alignas(ADS1115_CACHE_LINE) _Atomic uint64_t ui64_watermark_ns;
+	_Atomic uint64_t ui64_errors;
+
+	// producer side -- samples not yet passed by the watermark, in stamp order
+	ads1115_sample held[ADS1115_ACQ_HOLD];
+	int i_held;
+
+	// consumer side -- the next sample of this bus waiting to be merged
+	_Alignas(ADS1115_CACHE_LINE) ads1115_sample head;
+	uint8_t ui8_head_valid;
+	} ads1115_acq_worker;
+
+typedef struct ads1115_acq_group {
+	ads1115_acq_worker workers[ADS1115_ACQ_GROUP_BUSES];
+	int i_worker_count;
+	_Atomic int i_running;
+	} ads1115_acq_group;
+#else
+// _Atomic and _Alignas are C only, C++ sees the handles through pointers
+typedef struct ads1115_ring ads1115_ring;
+typedef struct ads1115_acq ads1115_acq;
+typedef struct ads1115_acq_group ads1115_acq_group;
+#endif
+//**********************************************************************
+//PROTOTYPE*************************************************************
+int ADS1115_ring_init(ads1115_ring *ring, uint32_t ui32_capacity);
+void ADS1115_ring_free(ads1115_ring *ring);
+int ADS1115_ring_push(ads1115_ring *ring, const ads1115_sample *sample);
+int ADS1115_ring_drain(ads1115_ring *ring, ads1115_sample *samples, int max);
+
+ads1115_acq *ADS1115_acq_create(ads1115_dev *dev, uint32_t ui32_capacity);
+int ADS1115_acq_start(ads1115_acq *acq, int i_cpu, int i_fifo_priority);
+void ADS1115_acq_stop(ads1115_acq *acq);
+int ADS1115_acq_drain(ads1115_acq *acq, ads1115_sample *samples, int max);
+uint64_t ADS1115_acq_get_overruns(ads1115_acq *acq);
+uint64_t ADS1115_acq_get_errors(ads1115_acq *acq);
+void ADS1115_acq_destroy(ads1115_acq *acq);
+
+ads1115_acq_group *ADS1115_acq_group_create(ads1115_dev **devs, int count, uint32_t ui32_capacity);
+int ADS1115_acq_group_start(ads1115_acq_group *group, const int *iarr_cpus, int i_fifo_priority);
+void ADS1115_acq_group_stop(ads1115_acq_group *group);
+int ADS1115_acq_group_drain(ads1115_acq_group *group, ads1115_sample *samples, int max);
+uint64_t ADS1115_acq_group_get_overruns(ads1115_acq_group *group);
+uint64_t ADS1115_acq_group_get_errors(ads1115_acq_group *group);
+void ADS1115_acq_group_destroy(ads1115_acq_group *group);
+//**********************************************************************
+#ifdef __cplusplus
+}
+#endif
+#endif
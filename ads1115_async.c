@@ -0,0 +1,334 @@
+/* File:		ads1115_async.c
+ * Purpose: 	non-blocking single shot conversions for event loops
+ *
+ * Preface:		see ads1115_async.h. A request is first looked at just
+ * 				after its conversion should end at the oscillator speed
+ * 				learned for the device, like ADS1115_wait_conversion(),
+ * 				and teaches that estimate in the same way, then every
+ * 				period / ADS1115_POLL_DIVIDER until it is done or its
+ * 				device timeout runs out. The timer fd is armed in
+ * 				absolute CLOCK_MONOTONIC time for the earliest of these.
+ * */
+#define _GNU_SOURCE			// CLOCK_MONOTONIC under -std=c11
+#include "ads1115_async.h"
+#include "ads1115_internal.h"
+
+ads1115_async *ADS1115_async_create() {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_async_create");
+	ads1115_async *async = calloc(1, sizeof(ads1115_async));
+	if (async == NULL) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_async_create - calloc: %s", strerror(errno));
+		return NULL;
+		}
+	async->ui32_next_token = 1;
+	async->i_event_fd = -1;
+	async->i_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (async->i_timer_fd < 0) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_async_create - timerfd_create: %s", strerror(errno));
+		ADS1115_async_destroy(async);
+		return NULL;
+		}
+	async->i_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (async->i_event_fd < 0) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_async_create - eventfd: %s", strerror(errno));
+		ADS1115_async_destroy(async);
+		return NULL;
+		}
+	return async;
+	}
+
+int ADS1115_async_get_timer_fd(ads1115_async *async) {
+	return async->i_timer_fd;
+	}
+
+int ADS1115_async_get_event_fd(ads1115_async *async) {
+	return async->i_event_fd;
+	}
+
+int ADS1115_async_in_flight(const ads1115_async_request *request) {
+	return (request->ui8_state == ASYNC_CONVERTING || request->ui8_state == ASYNC_CANCELLED);
+	}
+
+uint64_t ADS1115_async_next_due(ads1115_async *async) {
+	// earliest time a request needs the bus, 0 when nothing is in flight
+	uint64_t ui64_due = 0;
+	for (int c = 0; c < ADS1115_ASYNC_REQUESTS; c++) {
+		ads1115_async_request *request = &async->requests[c];
+		if (ADS1115_async_in_flight(request) && (ui64_due == 0 || request->ui64_due_ns < ui64_due)) {
+			ui64_due = request->ui64_due_ns;
+			}
+		}
+	return ui64_due;
+	}
+
+void ADS1115_async_rearm(ads1115_async *async) {
+	// an all zero value disarms the timer, a time already past fires it at once
+	uint64_t ui64_due = ADS1115_async_next_due(async);
+	struct itimerspec its_due = {{0, 0}, {ui64_due / 1000000000ULL, ui64_due % 1000000000ULL}};
+	if (timerfd_settime(async->i_timer_fd, TFD_TIMER_ABSTIME, &its_due, NULL) < 0) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_async_rearm - timerfd_settime: %s", strerror(errno));
+		}
+	}
+
+int ADS1115_async_get_timeout_ms(ads1115_async *async) {
+	// poll() timeout until ADS1115_async_process() is next needed, -1 when idle
+	uint64_t ui64_due = ADS1115_async_next_due(async);
+	if (ui64_due == 0) {
+		return -1;
+		}
+	uint64_t ui64_now = ADS1115_get_timestamp_ns();
+	if (ui64_due <= ui64_now) {
+		return 0;
+		}
+	return (int)((ui64_due - ui64_now + 999999) / 1000000);
+	}
+
+int ADS1115_async_find(ads1115_async *async, uint32_t ui32_token) {
+	for (int c = 0; c < ADS1115_ASYNC_REQUESTS; c++) {
+		if (async->requests[c].ui8_state != ASYNC_FREE && async->requests[c].result.ui32_token == ui32_token) {
+			return c;
+			}
+		}
+	return -1;
+	}
+
+int ADS1115_async_begin(ads1115_async *async, int i_request) {
+	// send the config write that starts the conversion and schedule the first look
+	ads1115_async_request *request = &async->requests[i_request];
+	if (ADS1115_start_single_raw(request->dev) != ADS1115_OK) {
+		return ADS1115_ERROR_IO;
+		}
+	uint64_t ui64_now = ADS1115_get_timestamp_ns();
+	long l_period_ns = ADS1115_get_conversion_period_ns(request->dev);
+	request->ui8_state = ASYNC_CONVERTING;
+	request->ui64_start_ns = ui64_now;
+	request->ui8_polls = 0;
+
+	// the device setup may change before the result is read, keep what this one converts with
+	request->ui8_mult_mask = request->dev->ui8_config_register_mult_mask;
+	request->ui8_pga_mask = request->dev->ui8_config_register_pga_mask;
+	request->ui8_rate_mask = request->dev->ui8_config_register_conversion_rate_mask;
+	request->ui64_due_ns = ui64_now + ADS1115_drift_first_poll_ns(request->dev, request->ui8_rate_mask);
+	request->ui64_deadline_ns = ui64_now + request->dev->i_timeout_ms * 1000000ULL;
+	if (request->ui64_due_ns > request->ui64_deadline_ns) {
+		request->ui64_due_ns = request->ui64_deadline_ns;
+		}
+	request->ui64_poll_ns = l_period_ns / ADS1115_POLL_DIVIDER;
+	return ADS1115_OK;
+	}
+
+void ADS1115_async_complete(ads1115_async *async, int i_request, int i_status);
+
+void ADS1115_async_begin_next(ads1115_async *async, ads1115_dev *dev) {
+	// the device is free again, start its oldest queued request
+	int i_next = -1;
+	for (int c = 0; c < ADS1115_ASYNC_REQUESTS; c++) {
+		ads1115_async_request *request = &async->requests[c];
+		if (request->ui8_state != ASYNC_QUEUED || request->dev != dev) {
+			continue;
+			}
+		// tokens count up and may wrap, compare by difference
+		if (i_next < 0 || (int32_t)(request->result.ui32_token - async->requests[i_next].result.ui32_token) < 0) {
+			i_next = c;
+			}
+		}
+	// a failed start completes the request, which starts the next one in turn
+	if (i_next >= 0 && ADS1115_async_begin(async, i_next) != ADS1115_OK) {
+		ADS1115_async_complete(async, i_next, ADS1115_ERROR_IO);
+		}
+	}
+
+void ADS1115_async_complete(ads1115_async *async, int i_request, int i_status) {
+	ads1115_async_request *request = &async->requests[i_request];
+	ads1115_dev *dev = request->dev;
+	request->result.i_status = i_status;
+
+	if (request->ui8_state == ASYNC_CANCELLED) {
+		// the conversion had to run out before the device could take the next one
+		request->ui8_state = ASYNC_FREE;
+		ADS1115_async_begin_next(async, dev);
+		}
+	else if (request->callback != NULL) {
+		// free the slot first, the callback may start new requests
+		ads1115_async_result result = request->result;
+		ads1115_async_callback callback = request->callback;
+		void *context = request->context;
+		request->ui8_state = ASYNC_FREE;
+
+		// queued requests keep their turn ahead of ones the callback starts
+		ADS1115_async_begin_next(async, dev);
+		callback(&result, context);
+		}
+	else {
+		request->ui8_state = ASYNC_DONE;
+		async->ui8arr_done[(async->i_done_head + async->i_done_count) % ADS1115_ASYNC_REQUESTS] = i_request;
+		async->i_done_count++;
+		uint64_t ui64_one = 1;
+		if (write(async->i_event_fd, &ui64_one, sizeof(ui64_one)) < 0) {
+			ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_async_complete - write: %s", strerror(errno));
+			}
+		ADS1115_async_begin_next(async, dev);
+		}
+	}
+
+int ADS1115_async_start(ads1115_async *async, ads1115_dev *dev, ads1115_async_callback callback, void *context, uint32_t *ui32_token) {
+	// start a single shot conversion on dev, or queue it behind the one in flight
+	ADS1115_TRACE(ADS1115_TRACE_DEBUG, "ADS1115_async_start");
+	int i_request = -1;
+	int i_busy = 0;
+	for (int c = 0; c < ADS1115_ASYNC_REQUESTS; c++) {
+		ads1115_async_request *request = &async->requests[c];
+		if (request->ui8_state == ASYNC_FREE) {
+			if (i_request < 0) {
+				i_request = c;
+				}
+			}
+		else if (request->dev == dev && (request->ui8_state == ASYNC_QUEUED || ADS1115_async_in_flight(request))) {
+			i_busy = 1;
+			}
+		}
+	if (i_request < 0) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_async_start - all %d requests in use", ADS1115_ASYNC_REQUESTS);
+		return ADS1115_ERROR_INVALID;
+		}
+
+	ads1115_async_request *request = &async->requests[i_request];
+	memset(request, 0, sizeof(ads1115_async_request));
+	request->ui8_state = ASYNC_QUEUED;
+	request->dev = dev;
+	request->callback = callback;
+	request->context = context;
+	request->result.ui32_token = async->ui32_next_token++;
+	if (async->ui32_next_token == 0) {
+		async->ui32_next_token = 1;
+		}
+
+	if (!i_busy) {
+		if (ADS1115_async_begin(async, i_request) != ADS1115_OK) {
+			request->ui8_state = ASYNC_FREE;
+			return ADS1115_ERROR_IO;
+			}
+		ADS1115_async_rearm(async);
+		}
+	if (ui32_token != NULL) {
+		*ui32_token = request->result.ui32_token;
+		}
+	return ADS1115_OK;
+	}
+
+int ADS1115_async_cancel(ads1115_async *async, uint32_t ui32_token) {
+	// completed requests are no longer cancelled, collect them instead
+	int i_request = ADS1115_async_find(async, ui32_token);
+	if (i_request < 0 || async->requests[i_request].ui8_state == ASYNC_DONE || async->requests[i_request].ui8_state == ASYNC_CANCELLED) {
+		return ADS1115_ERROR_INVALID;
+		}
+	ads1115_async_request *request = &async->requests[i_request];
+	if (request->ui8_state == ASYNC_QUEUED) {
+		request->ui8_state = ASYNC_FREE;
+		}
+	else {
+		// the chip ignores a start while converting, so the device stays
+		// taken until this conversion is done -- its result is dropped
+		request->ui8_state = ASYNC_CANCELLED;
+		}
+	return ADS1115_OK;
+	}
+
+int ADS1115_async_process(ads1115_async *async) {
+	// call when the timer fd is readable, returns the number of requests completed
+	uint64_t ui64_expirations;
+	if (read(async->i_timer_fd, &ui64_expirations, sizeof(ui64_expirations)) < 0 && errno != EAGAIN) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_async_process - read: %s", strerror(errno));
+		}
+
+	// requests started from callbacks during the pass are not due yet
+	int i_completed = 0;
+	uint64_t ui64_now = ADS1115_get_timestamp_ns();
+	for (int c = 0; c < ADS1115_ASYNC_REQUESTS; c++) {
+		ads1115_async_request *request = &async->requests[c];
+		if (!ADS1115_async_in_flight(request) || request->ui64_due_ns > ui64_now) {
+			continue;
+			}
+		ads1115_dev *dev = request->dev;
+		uint8_t ui8_rate_mask = request->ui8_rate_mask;
+		uint64_t ui64_sent = ADS1115_get_timestamp_ns();
+		int16_t i16_code;
+		int i_status = ADS1115_poll_single_raw(dev, &i16_code);
+		if (i_status == ADS1115_PENDING) {
+			// a first look pulled in to the deadline says nothing about the latency
+			if (request->ui8_polls++ == 0 && request->ui64_due_ns < request->ui64_deadline_ns && !ADS1115_ready_wait_enabled(dev)) {
+				ADS1115_drift_busy(dev, ui8_rate_mask, request->ui64_start_ns, ui64_sent);
+				}
+			ui64_now = ADS1115_get_timestamp_ns();
+			if (ui64_now < request->ui64_deadline_ns) {
+				request->ui64_due_ns = ui64_now + request->ui64_poll_ns;
+				continue;
+				}
+			ADS1115_TRACE(ADS1115_TRACE_WARNING, "ADS1115_async_process - timeout");
+			ADS1115_STAT_ADD(dev, ui64_timeouts, 1);
+			i_status = ADS1115_ERROR_TIMEOUT;
+			}
+		else if (i_status == ADS1115_OK) {
+			// stamp the sample with when the conversion ended, not when the loop got to it
+			uint64_t ui64_done = ADS1115_get_timestamp_ns();
+			if (!ADS1115_ready_wait_enabled(dev)) {
+				dev->ui64_ready_ns = ADS1115_drift_done(dev, ui8_rate_mask, request->ui64_start_ns, ui64_done, request->ui8_polls == 0);
+				}
+			else if (dev->ui64_alert_ns > request->ui64_start_ns) {
+				ADS1115_drift_single(dev, ui8_rate_mask, dev->ui64_alert_ns - request->ui64_start_ns);
+				dev->ui64_ready_ns = dev->ui64_alert_ns;
+				}
+			else {
+				dev->ui64_ready_ns = ui64_done;
+				}
+			ADS1115_tag_sample(dev, &request->result.sample, dev->ui64_ready_ns, i16_code);
+			request->result.sample.ui8_mult_mask = request->ui8_mult_mask;
+			request->result.sample.ui8_pga_mask = request->ui8_pga_mask;
+			request->result.sample.ui8_rate_mask = ui8_rate_mask;
+			ADS1115_record_latency(dev, ui64_done - request->ui64_start_ns);
+			}
+		if (request->ui8_state == ASYNC_CONVERTING) {
+			i_completed++;
+			}
+		ADS1115_async_complete(async, c, i_status);
+		}
+	ADS1115_async_rearm(async);
+	return i_completed;
+	}
+
+int ADS1115_async_collect(ads1115_async *async, ads1115_async_result *results, int max) {
+	// call when the event fd is readable, returns the number of results copied out
+	uint64_t ui64_count;
+	if (read(async->i_event_fd, &ui64_count, sizeof(ui64_count)) < 0 && errno != EAGAIN) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_async_collect - read: %s", strerror(errno));
+		}
+	int i_collected = 0;
+	while (i_collected < max && async->i_done_count > 0) {
+		ads1115_async_request *request = &async->requests[async->ui8arr_done[async->i_done_head]];
+		results[i_collected++] = request->result;
+		request->ui8_state = ASYNC_FREE;
+		async->i_done_head = (async->i_done_head + 1) % ADS1115_ASYNC_REQUESTS;
+		async->i_done_count--;
+		}
+
+	// keep the event fd readable for what did not fit
+	if (async->i_done_count > 0) {
+		uint64_t ui64_one = 1;
+		if (write(async->i_event_fd, &ui64_one, sizeof(ui64_one)) < 0) {
+			ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_async_collect - write: %s", strerror(errno));
+			}
+		}
+	return i_collected;
+	}
+
+void ADS1115_async_destroy(ads1115_async *async) {
+	// conversions still running on the chips simply finish unread
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_async_destroy");
+	if (async->i_timer_fd >= 0) {
+		close(async->i_timer_fd);
+		}
+	if (async->i_event_fd >= 0) {
+		close(async->i_event_fd);
+		}
+	free(async);
+	}
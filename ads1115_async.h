@@ -0,0 +1,110 @@
+/* File:		ads1115_async.h
+ * Purpose: 	non-blocking single shot conversions for event loops
+ *
+ * Preface:		ads1115_async.h - starts conversions without waiting for
+ * 				them. ADS1115_async_start() writes the config register,
+ * 				hands back a request token and returns; the conversion
+ * 				time is spent in the caller's event loop instead of in
+ * 				clock_nanosleep(). One thread can then drive any number of
+ * 				chips next to its sockets and timers.
+ *
+ * 				The context owns two fds for epoll:
+ *
+ * 				timer fd	a CLOCK_MONOTONIC timerfd armed for the next
+ * 							moment a request needs the bus. When it is
+ * 							readable call ADS1115_async_process(), which
+ * 							reads finished conversions, gives up on
+ * 							requests past their timeout and rearms it.
+ * 				event fd	an eventfd, readable while completed requests
+ * 							without a callback are waiting to be picked up
+ * 							with ADS1115_async_collect().
+ *
+ * 				A request started with a callback is completed by calling
+ * 				it from inside ADS1115_async_process() instead; it may
+ * 				start new requests. Loops built on poll() without epoll
+ * 				can use ADS1115_async_get_timeout_ms() in place of the
+ * 				timer fd.
+ *
+ * 				Requests on one device run one after the other in start
+ * 				order, each converting with the device setup as it was
+ * 				when the request reached the chip and its sample tagged
+ * 				with that setup; requests on different devices overlap. With ready mode and an alert fd on the
+ * 				device (see ADS1115_set_ready_mode()) the "done" check is
+ * 				a look at the alert fd rather than a config register read.
+ * 				Register writes and reads themselves still go through the
+ * 				blocking transport, a few hundred microseconds each at
+ * 				100 kHz. A device handed to the context must not be used
+ * 				elsewhere while it has requests in flight.
+ * */
+#ifndef ADS1115_ASYNC_H
+#define ADS1115_ASYNC_H
+
+#include "ads1115.h"
+#include <sys/timerfd.h>	// timerfd_create(), timerfd_settime()
+#include <sys/eventfd.h>	// eventfd()
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+//DEFINE****************************************************************
+#define ADS1115_ASYNC_REQUESTS		32
+
+enum ADS1115_ASYNC_STATE {
+	ASYNC_FREE,
+	ASYNC_QUEUED,				// waiting for an earlier request on its device
+	ASYNC_CONVERTING,
+	ASYNC_CANCELLED,			// converting, the result is dropped
+	ASYNC_DONE					// completed, waiting for ADS1115_async_collect()
+	};
+
+typedef struct ads1115_async_result {
+	uint32_t ui32_token;
+	int i_status;				// ADS1115_STATUS, sample is only valid on ADS1115_OK
+	ads1115_sample sample;
+	} ads1115_async_result;
+
+typedef void (*ads1115_async_callback)(const ads1115_async_result *result, void *context);
+
+typedef struct ads1115_async_request {
+	uint8_t ui8_state;
+	uint8_t ui8_polls;				// "done" checks that found it still converting
+	uint8_t ui8_mult_mask;			// device setup the conversion started with
+	uint8_t ui8_pga_mask;
+	uint8_t ui8_rate_mask;
+	ads1115_dev *dev;
+	ads1115_async_callback callback;
+	void *context;
+	uint64_t ui64_start_ns;
+	uint64_t ui64_due_ns;			// next time the request needs the bus
+	uint64_t ui64_deadline_ns;
+	uint64_t ui64_poll_ns;
+	ads1115_async_result result;
+	} ads1115_async_request;
+
+typedef struct ads1115_async {
+	int i_timer_fd;
+	int i_event_fd;
+	uint32_t ui32_next_token;
+	ads1115_async_request requests[ADS1115_ASYNC_REQUESTS];
+
+	// completed requests in completion order, indices into requests
+	uint8_t ui8arr_done[ADS1115_ASYNC_REQUESTS];
+	int i_done_head;
+	int i_done_count;
+	} ads1115_async;
+//**********************************************************************
+//PROTOTYPE*************************************************************
+ads1115_async *ADS1115_async_create();
+int ADS1115_async_get_timer_fd(ads1115_async *async);
+int ADS1115_async_get_event_fd(ads1115_async *async);
+int ADS1115_async_get_timeout_ms(ads1115_async *async);
+int ADS1115_async_start(ads1115_async *async, ads1115_dev *dev, ads1115_async_callback callback, void *context, uint32_t *ui32_token);
+int ADS1115_async_cancel(ads1115_async *async, uint32_t ui32_token);
+int ADS1115_async_process(ads1115_async *async);
+int ADS1115_async_collect(ads1115_async *async, ads1115_async_result *results, int max);
+void ADS1115_async_destroy(ads1115_async *async);
+//**********************************************************************
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,255 @@
+/* File:		ads1115_bench.c
+ * Purpose: 	throughput, latency and jitter benchmark for ads1115.c
+ *
+ * Preface:		runs every RATE_MASK through single shot conversions,
+ * 				averaged conversions, a continuous stream and a four
+ * 				channel scan sweep, and prints one JSON object per case:
+ * 				samples/s, per-operation latency percentiles, inter-sample
+ * 				jitter, bus bytes and transfers (one syscall each on
+ * 				i2c-dev) per sample. Output is one line per case so two
+ * 				runs can be diffed directly.
+ *
+ * 				By default the chip is the simulator from ads1115_sim.h
+ * 				on a 100 kHz bus; -d <bus> <address> runs against real
+ * 				hardware instead.
+ *
+ * Usage:		ads1115_bench [-n samples] [-t ms] [-b bus_hz] [-d bus address]
+ */
+
+#include "ads1115.h"
+#include "ads1115_sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#define BENCH_AVERAGE_COUNT		8
+#define BENCH_SCAN_CHANNELS		4
+
+// wraps the device transport to count what goes over the bus
+typedef struct bench_counter {
+	ads1115_transport inner;
+	uint64_t ui64_transfers;
+	uint64_t ui64_bytes;
+	} bench_counter;
+
+typedef struct bench_result {
+	const char *cp_mode;
+	int i_rate_sps;
+	int i_samples;
+	int i_operations;
+	uint64_t ui64_elapsed_ns;
+	uint64_t *ui64arr_latency_ns;
+	uint64_t *ui64arr_done_ns;
+	uint64_t ui64_transfers;
+	uint64_t ui64_bytes;
+	int i_errors;
+	} bench_result;
+
+const enum RATE_MASK earr_rates[8] = {SPS_8, SPS_16, SPS_32, SPS_64, SPS_128, SPS_250, SPS_475, SPS_860};
+const int iarr_rates_sps[8] = {8, 16, 32, 64, 128, 250, 475, 860};
+const enum MULT_MASK earr_channels[BENCH_SCAN_CHANNELS] = {MULT_AIN_0, MULT_AIN_1, MULT_AIN_2, MULT_AIN_3};
+
+int bench_transfer(void *context, struct i2c_msg *msgs, int count) {
+	bench_counter *counter = context;
+	counter->ui64_transfers++;
+	for (int c = 0; c < count; c++) {
+		counter->ui64_bytes += 1 + msgs[c].len; // address byte + data
+		}
+	return counter->inner.transfer(counter->inner.context, msgs, count);
+	}
+
+void bench_close(void *context) {
+	bench_counter *counter = context;
+	if (counter->inner.close != NULL) {
+		counter->inner.close(counter->inner.context);
+		}
+	}
+
+int bench_compare(const void *a, const void *b) {
+	uint64_t x = *(const uint64_t *)a;
+	uint64_t y = *(const uint64_t *)b;
+	return (x > y) - (x < y);
+	}
+
+double bench_percentile_us(uint64_t *ui64arr_sorted, int count, double d_percentile) {
+	if (count == 0) {
+		return 0;
+		}
+	int i_index = (int)(d_percentile / 100.0 * (count - 1) + 0.5);
+	return ui64arr_sorted[i_index] / 1000.0;
+	}
+
+void bench_report(bench_result *result) {
+	// jitter -- standard deviation of the interval between completed operations
+	double d_mean = 0;
+	double d_variance = 0;
+	int i_intervals = result->i_operations - 1;
+	for (int c = 0; c < i_intervals; c++) {
+		d_mean += (double)(result->ui64arr_done_ns[c + 1] - result->ui64arr_done_ns[c]);
+		}
+	if (i_intervals > 0) {
+		d_mean /= i_intervals;
+		for (int c = 0; c < i_intervals; c++) {
+			double d_delta = (double)(result->ui64arr_done_ns[c + 1] - result->ui64arr_done_ns[c]) - d_mean;
+			d_variance += d_delta * d_delta;
+			}
+		d_variance /= i_intervals;
+		}
+
+	qsort(result->ui64arr_latency_ns, result->i_operations, sizeof(uint64_t), bench_compare);
+	int i_samples = (result->i_samples > 0) ? result->i_samples : 1;
+	printf("{\"mode\":\"%s\",\"rate_sps\":%d,\"samples\":%d,\"errors\":%d,"
+		"\"samples_per_s\":%.2f,"
+		"\"latency_us\":{\"p50\":%.1f,\"p90\":%.1f,\"p99\":%.1f,\"max\":%.1f},"
+		"\"interval_us\":%.1f,\"jitter_us\":%.1f,"
+		"\"bus_bytes_per_sample\":%.2f,\"transfers_per_sample\":%.2f}\n",
+		result->cp_mode, result->i_rate_sps, result->i_samples, result->i_errors,
+		result->ui64_elapsed_ns ? result->i_samples * 1e9 / result->ui64_elapsed_ns : 0.0,
+		bench_percentile_us(result->ui64arr_latency_ns, result->i_operations, 50),
+		bench_percentile_us(result->ui64arr_latency_ns, result->i_operations, 90),
+		bench_percentile_us(result->ui64arr_latency_ns, result->i_operations, 99),
+		bench_percentile_us(result->ui64arr_latency_ns, result->i_operations, 100),
+		d_mean / 1000.0, sqrt(d_variance) / 1000.0,
+		(double)result->ui64_bytes / i_samples, (double)result->ui64_transfers / i_samples);
+	fflush(stdout);
+	}
+
+int bench_operation(ads1115_dev *dev, const char *cp_mode, int16_t *i16arr_codes) {
+	// one timed operation, returns the number of samples it produced
+	if (strcmp(cp_mode, "single") == 0) {
+		return (ADS1115_get_single_raw(dev, i16arr_codes) == ADS1115_OK) ? 1 : ADS1115_ERROR_IO;
+		}
+	if (strcmp(cp_mode, "average") == 0) {
+		double d_average;
+		return (ADS1115_get_average_conversions(dev, BENCH_AVERAGE_COUNT, &d_average) == ADS1115_OK) ? BENCH_AVERAGE_COUNT : ADS1115_ERROR_IO;
+		}
+	if (strcmp(cp_mode, "stream") == 0) {
+		return ADS1115_read_stream_raw(dev, i16arr_codes, 1);
+		}
+	return ADS1115_scan_sweep_raw(dev, i16arr_codes);
+	}
+
+void bench_run(ads1115_dev *dev, bench_counter *counter, const char *cp_mode, int i_rate, int i_max_samples, int i_budget_ms) {
+	bench_result result = {cp_mode, iarr_rates_sps[i_rate], 0, 0, 0, NULL, NULL, 0, 0, 0};
+	result.ui64arr_latency_ns = calloc(i_max_samples, sizeof(uint64_t));
+	result.ui64arr_done_ns = calloc(i_max_samples, sizeof(uint64_t));
+	if (result.ui64arr_latency_ns == NULL || result.ui64arr_done_ns == NULL) {
+		fprintf(stderr, "%s %d sps: out of memory for %d samples\n", cp_mode, result.i_rate_sps, i_max_samples);
+		free(result.ui64arr_latency_ns);
+		free(result.ui64arr_done_ns);
+		return;
+		}
+	int16_t i16arr_codes[ADS1115_SCAN_LIST_MAX];
+
+	// set up the case
+	ADS1115_scan_clear(dev);
+	ADS1115_set_multiplex(dev, MULT_AIN_0);
+	ADS1115_set_conversion_rate(dev, earr_rates[i_rate]);
+	ADS1115_set_conversion_mode(dev, (strcmp(cp_mode, "stream") == 0) ? CONTINUOUS : SINGLE);
+	if (strcmp(cp_mode, "sweep") == 0) {
+		for (int c = 0; c < BENCH_SCAN_CHANNELS; c++) {
+			ADS1115_scan_add(dev, earr_channels[c], PGA_4_096, earr_rates[i_rate]);
+			}
+		}
+	if (strcmp(cp_mode, "stream") == 0) {
+		// prime the stream so the config write is not charged to the first sample
+		bench_operation(dev, cp_mode, i16arr_codes);
+		}
+
+	uint64_t ui64_transfers = counter->ui64_transfers;
+	uint64_t ui64_bytes = counter->ui64_bytes;
+	uint64_t ui64_start = ADS1115_get_timestamp_ns();
+	uint64_t ui64_deadline = ui64_start + (uint64_t)i_budget_ms * 1000000ULL;
+	uint64_t ui64_now = ui64_start;
+	while (result.i_samples < i_max_samples && result.i_operations < i_max_samples && ui64_now < ui64_deadline) {
+		uint64_t ui64_before = ADS1115_get_timestamp_ns();
+		int i_count = bench_operation(dev, cp_mode, i16arr_codes);
+		ui64_now = ADS1115_get_timestamp_ns();
+		if (i_count <= 0) {
+			result.i_errors++;
+			continue;
+			}
+		result.ui64arr_latency_ns[result.i_operations] = ui64_now - ui64_before;
+		result.ui64arr_done_ns[result.i_operations] = ui64_now;
+		result.i_operations++;
+		result.i_samples += i_count;
+		}
+	result.ui64_elapsed_ns = ui64_now - ui64_start;
+	result.ui64_transfers = counter->ui64_transfers - ui64_transfers;
+	result.ui64_bytes = counter->ui64_bytes - ui64_bytes;
+	bench_report(&result);
+
+	free(result.ui64arr_latency_ns);
+	free(result.ui64arr_done_ns);
+	}
+
+int main(int argc, char **argv) {
+	int i_max_samples = 256;
+	int i_budget_ms = 1000;
+	uint32_t ui32_bus_hz = 100000;
+	int i_bus = -1;
+	int i_address = GND;
+
+	for (int c = 1; c < argc; c++) {
+		if (strcmp(argv[c], "-n") == 0 && c + 1 < argc) {
+			i_max_samples = atoi(argv[++c]);
+			}
+		else if (strcmp(argv[c], "-t") == 0 && c + 1 < argc) {
+			i_budget_ms = atoi(argv[++c]);
+			}
+		else if (strcmp(argv[c], "-b") == 0 && c + 1 < argc) {
+			ui32_bus_hz = atoi(argv[++c]);
+			}
+		else if (strcmp(argv[c], "-d") == 0 && c + 2 < argc) {
+			i_bus = atoi(argv[++c]);
+			i_address = strtol(argv[++c], NULL, 0);
+			}
+		else {
+			fprintf(stderr, "usage: %s [-n samples] [-t ms] [-b bus_hz] [-d bus address]\n", argv[0]);
+			return 1;
+			}
+		}
+	if (i_max_samples < 2) {
+		i_max_samples = 2;
+		}
+
+	ads1115_sim_bus *bus = NULL;
+	bench_counter counter = {{NULL, NULL, NULL}, 0, 0};
+	if (i_bus < 0) {
+		// software model with a different signal on each input
+		bus = ADS1115_sim_create(ui32_bus_hz);
+		ADS1115_sim_add_chip(bus, i_address);
+		ADS1115_sim_set_input(bus, i_address, 0, SIM_CONSTANT, 1.0, 0, 0, 0.001);
+		ADS1115_sim_set_input(bus, i_address, 1, SIM_SINE, 0, 2.0, 5.0, 0.001);
+		ADS1115_sim_set_input(bus, i_address, 2, SIM_SQUARE, 0.5, 0.5, 2.0, 0.001);
+		ADS1115_sim_set_input(bus, i_address, 3, SIM_RAMP, 0, 3.0, 1.0, 0.001);
+		ADS1115_sim_get_transport(bus, &counter.inner);
+		}
+	else if (ADS1115_linux_get_transport(i_bus, i_address, &counter.inner) != ADS1115_OK) {
+		return 1;
+		}
+
+	// the device goes through the counter, closing it closes the wrapped transport
+	ads1115_transport transport = {bench_transfer, bench_close, &counter};
+	ads1115_dev *dev = ADS1115_init_transport(&transport, (i_bus < 0) ? 0 : i_bus, i_address);
+	if (dev == NULL) {
+		bench_close(&counter);
+		if (bus != NULL) {
+			ADS1115_sim_destroy(bus);
+			}
+		return 1;
+		}
+
+	const char *cparr_modes[4] = {"single", "average", "stream", "sweep"};
+	for (int m = 0; m < 4; m++) {
+		for (int r = 0; r < 8; r++) {
+			bench_run(dev, &counter, cparr_modes[m], r, i_max_samples, i_budget_ms);
+			}
+		}
+
+	ADS1115_close(dev);
+	if (bus != NULL) {
+		ADS1115_sim_destroy(bus);
+		}
+	return 0;
+	}
@@ -0,0 +1,524 @@
+/* File:		ads1115_capture.c
+ * Purpose: 	compact binary capture files for ads1115_sample streams
+ *
+ * Preface:		see ads1115_capture.h for the file layout. Integers are
+ * 				packed byte by byte so files move between hosts of either
+ * 				byte order. ADS1115_capture_seek() binary searches the
+ * 				index, which relies on timestamps rising from block to
+ * 				block as CLOCK_MONOTONIC ones do.
+ * */
+#define _GNU_SOURCE			// O_CLOEXEC under -std=c11
+#include "ads1115_capture.h"
+
+void ADS1115_capture_put_le(uint8_t *ui8arr_buffer, uint64_t ui64_value, int i_bytes) {
+	for (int c = 0; c < i_bytes; c++) {
+		ui8arr_buffer[c] = (uint8_t)(ui64_value >> (8 * c));
+		}
+	}
+
+uint64_t ADS1115_capture_get_le(const uint8_t *ui8arr_buffer, int i_bytes) {
+	uint64_t ui64_value = 0;
+	for (int c = 0; c < i_bytes; c++) {
+		ui64_value |= (uint64_t)ui8arr_buffer[c] << (8 * c);
+		}
+	return ui64_value;
+	}
+
+int ADS1115_capture_put_varint(uint8_t *ui8arr_buffer, uint64_t ui64_value) {
+	// 7 bits per byte, high bit set on every byte but the last
+	int i_bytes = 0;
+	while (ui64_value >= 0x80) {
+		ui8arr_buffer[i_bytes++] = (uint8_t)(ui64_value | 0x80);
+		ui64_value >>= 7;
+		}
+	ui8arr_buffer[i_bytes++] = (uint8_t)ui64_value;
+	return i_bytes;
+	}
+
+int ADS1115_capture_get_varint(const uint8_t **ui8arr_cursor, const uint8_t *ui8arr_end, uint64_t *ui64_value) {
+	uint64_t ui64_result = 0;
+	for (int i_shift = 0; i_shift < 64; i_shift += 7) {
+		if (*ui8arr_cursor >= ui8arr_end) {
+			return ADS1115_ERROR_INVALID;
+			}
+		uint8_t ui8_byte = *(*ui8arr_cursor)++;
+		ui64_result |= (uint64_t)(ui8_byte & 0x7F) << i_shift;
+		if (!(ui8_byte & 0x80)) {
+			*ui64_value = ui64_result;
+			return ADS1115_OK;
+			}
+		}
+	return ADS1115_ERROR_INVALID;
+	}
+
+uint64_t ADS1115_capture_zigzag(int64_t i64_value) {
+	// small magnitudes of either sign map to small unsigned values
+	return ((uint64_t)i64_value << 1) ^ (uint64_t)(i64_value >> 63);
+	}
+
+int64_t ADS1115_capture_unzigzag(uint64_t ui64_value) {
+	return (int64_t)(ui64_value >> 1) ^ -(int64_t)(ui64_value & 1);
+	}
+
+void ADS1115_capture_reset_state(ads1115_capture_state *state, uint64_t ui64_first_ns) {
+	memset(state, 0, sizeof(ads1115_capture_state));
+	state->ui64_timestamp_ns = ui64_first_ns;
+	}
+
+uint32_t *ADS1115_capture_sequence(ads1115_capture_state *state, uint8_t ui8_bus_id, uint8_t ui8_address) {
+	// the last sequence number of the device, writer and reader keep the same table
+	uint16_t ui16_device = (uint16_t)(ui8_bus_id << 8 | ui8_address);
+	for (int c = 0; c < state->ui8_devices; c++) {
+		if (state->ui16arr_device[c] == ui16_device) {
+			return &state->ui32arr_sequence[c];
+			}
+		}
+	int i_slot;
+	if (state->ui8_devices < ADS1115_CAPTURE_DEVICES) {
+		i_slot = state->ui8_devices++;
+		}
+	else {
+		i_slot = state->ui8_replace;
+		state->ui8_replace = (state->ui8_replace + 1) % ADS1115_CAPTURE_DEVICES;
+		}
+	// a device new to the block expects sequence number 0
+	state->ui16arr_device[i_slot] = ui16_device;
+	state->ui32arr_sequence[i_slot] = UINT32_MAX;
+	return &state->ui32arr_sequence[i_slot];
+	}
+
+ads1115_capture_writer *ADS1115_capture_create(const char *cp_path, enum ADS1115_CAPTURE_FLAGS flags, uint32_t ui32_block_samples) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_capture_create");
+	if (ui32_block_samples == 0) {
+		ui32_block_samples = ADS1115_CAPTURE_BLOCK_SAMPLES;
+		}
+	ads1115_capture_writer *writer = calloc(1, sizeof(ads1115_capture_writer));
+	if (writer == NULL) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_capture_create - calloc: %s", strerror(errno));
+		return NULL;
+		}
+	writer->ui16_flags = flags;
+	writer->ui32_block_samples = ui32_block_samples;
+	writer->ui8arr_payload = malloc((size_t)ui32_block_samples * ADS1115_CAPTURE_SAMPLE_MAX);
+	writer->file = fopen(cp_path, "wb");
+	if (writer->ui8arr_payload == NULL || writer->file == NULL) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_capture_create - %s: %s", cp_path, strerror(errno));
+		if (writer->file != NULL) {
+			fclose(writer->file);
+			}
+		free(writer->ui8arr_payload);
+		free(writer);
+		return NULL;
+		}
+
+	uint8_t ui8arr_header[ADS1115_CAPTURE_HEADER_SIZE];
+	memcpy(ui8arr_header, ADS1115_CAPTURE_MAGIC, 8);
+	ADS1115_capture_put_le(&ui8arr_header[8], ADS1115_CAPTURE_VERSION, 2);
+	ADS1115_capture_put_le(&ui8arr_header[10], writer->ui16_flags, 2);
+	ADS1115_capture_put_le(&ui8arr_header[12], ui32_block_samples, 4);
+	if (fwrite(ui8arr_header, sizeof(ui8arr_header), 1, writer->file) != 1) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_capture_create - fwrite: %s", strerror(errno));
+		fclose(writer->file);
+		free(writer->ui8arr_payload);
+		free(writer);
+		return NULL;
+		}
+	writer->ui64_offset = ADS1115_CAPTURE_HEADER_SIZE;
+	return writer;
+	}
+
+int ADS1115_capture_flush(ads1115_capture_writer *writer) {
+	// write out the block being filled, a no-op when it is empty
+	if (writer->ui32_count == 0) {
+		return ADS1115_OK;
+		}
+	if (writer->ui32_blocks == writer->ui32_index_capacity) {
+		uint32_t ui32_capacity = writer->ui32_index_capacity ? writer->ui32_index_capacity * 2 : 64;
+		ads1115_capture_index *index = realloc(writer->index, ui32_capacity * sizeof(ads1115_capture_index));
+		if (index == NULL) {
+			ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_capture_flush - realloc: %s", strerror(errno));
+			return ADS1115_ERROR_INVALID;
+			}
+		writer->index = index;
+		writer->ui32_index_capacity = ui32_capacity;
+		}
+
+	uint8_t ui8arr_block[ADS1115_CAPTURE_BLOCK_SIZE];
+	ADS1115_capture_put_le(&ui8arr_block[0], ADS1115_CAPTURE_BLOCK_MAGIC, 4);
+	ADS1115_capture_put_le(&ui8arr_block[4], writer->ui32_payload_bytes, 4);
+	ADS1115_capture_put_le(&ui8arr_block[8], writer->ui32_count, 4);
+	ADS1115_capture_put_le(&ui8arr_block[12], 0, 4);
+	ADS1115_capture_put_le(&ui8arr_block[16], writer->ui64_first_ns, 8);
+	ADS1115_capture_put_le(&ui8arr_block[24], writer->state.ui64_timestamp_ns, 8);
+	if (fwrite(ui8arr_block, sizeof(ui8arr_block), 1, writer->file) != 1 ||
+		fwrite(writer->ui8arr_payload, writer->ui32_payload_bytes, 1, writer->file) != 1 ||
+		fflush(writer->file) != 0) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_capture_flush - fwrite: %s", strerror(errno));
+		return ADS1115_ERROR_IO;
+		}
+
+	ads1115_capture_index *entry = &writer->index[writer->ui32_blocks++];
+	entry->ui64_offset = writer->ui64_offset;
+	entry->ui64_first_ns = writer->ui64_first_ns;
+	entry->ui64_last_ns = writer->state.ui64_timestamp_ns;
+	entry->ui32_count = writer->ui32_count;
+	writer->ui64_offset += ADS1115_CAPTURE_BLOCK_SIZE + writer->ui32_payload_bytes;
+	writer->ui32_count = 0;
+	writer->ui32_payload_bytes = 0;
+	return ADS1115_OK;
+	}
+
+int ADS1115_capture_append(ads1115_capture_writer *writer, const ads1115_sample *samples, int count) {
+	for (int c = 0; c < count; c++) {
+		const ads1115_sample *sample = &samples[c];
+		ads1115_capture_state *state = &writer->state;
+
+		// a full block, or a time jump too large for the coder, starts a new block
+		int64_t i64_delta_ns = (int64_t)(sample->ui64_timestamp_ns - state->ui64_timestamp_ns);
+		int64_t i64_change_ns = i64_delta_ns - state->i64_delta_ns;
+		if (writer->ui32_count == writer->ui32_block_samples ||
+			i64_delta_ns > (INT64_C(1) << 60) || i64_delta_ns < -(INT64_C(1) << 60)) {
+			int i_status = ADS1115_capture_flush(writer);
+			if (i_status != ADS1115_OK) {
+				return i_status;
+				}
+			}
+		if (writer->ui32_count == 0) {
+			writer->ui64_first_ns = sample->ui64_timestamp_ns;
+			ADS1115_capture_reset_state(state, sample->ui64_timestamp_ns);
+			i64_delta_ns = 0;
+			i64_change_ns = 0;
+			}
+
+		uint8_t *ui8arr_out = &writer->ui8arr_payload[writer->ui32_payload_bytes];
+		int i_bytes = 0;
+		uint8_t ui8_gain_rate_mask = sample->ui8_pga_mask | sample->ui8_rate_mask;
+		int i_tag = !state->ui8_tagged || sample->ui8_mult_mask != state->ui8_mult_mask ||
+			ui8_gain_rate_mask != state->ui8_gain_rate_mask ||
+			sample->ui8_bus_id != state->ui8_bus_id || sample->ui8_address != state->ui8_address;
+		i_bytes += ADS1115_capture_put_varint(&ui8arr_out[i_bytes], ADS1115_capture_zigzag(i64_change_ns) << 1 | i_tag);
+		if (i_tag) {
+			ui8arr_out[i_bytes++] = sample->ui8_mult_mask;
+			ui8arr_out[i_bytes++] = ui8_gain_rate_mask;
+			ui8arr_out[i_bytes++] = sample->ui8_bus_id;
+			ui8arr_out[i_bytes++] = sample->ui8_address;
+			state->ui8_mult_mask = sample->ui8_mult_mask;
+			state->ui8_gain_rate_mask = ui8_gain_rate_mask;
+			state->ui8_bus_id = sample->ui8_bus_id;
+			state->ui8_address = sample->ui8_address;
+			state->ui8_tagged = 1;
+			}
+		uint32_t *ui32p_sequence = ADS1115_capture_sequence(state, sample->ui8_bus_id, sample->ui8_address);
+		i_bytes += ADS1115_capture_put_varint(&ui8arr_out[i_bytes], ADS1115_capture_zigzag((int32_t)(sample->ui32_sequence - (*ui32p_sequence + 1))));
+		*ui32p_sequence = sample->ui32_sequence;
+		if (writer->ui16_flags & ADS1115_CAPTURE_DELTA) {
+			i_bytes += ADS1115_capture_put_varint(&ui8arr_out[i_bytes], ADS1115_capture_zigzag((int32_t)sample->i16_code - state->i16_code));
+			}
+		else {
+			ADS1115_capture_put_le(&ui8arr_out[i_bytes], (uint16_t)sample->i16_code, 2);
+			i_bytes += 2;
+			}
+
+		state->ui64_timestamp_ns = sample->ui64_timestamp_ns;
+		state->i64_delta_ns = i64_delta_ns;
+		state->i16_code = sample->i16_code;
+		writer->ui32_payload_bytes += i_bytes;
+		writer->ui32_count++;
+		}
+	return ADS1115_OK;
+	}
+
+int ADS1115_capture_close(ads1115_capture_writer *writer) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_capture_close");
+	int i_status = ADS1115_capture_flush(writer);
+
+	// index and trailer let the reader skip walking the blocks
+	if (i_status == ADS1115_OK) {
+		uint8_t ui8arr_entry[ADS1115_CAPTURE_INDEX_SIZE];
+		for (uint32_t c = 0; c < writer->ui32_blocks && i_status == ADS1115_OK; c++) {
+			ADS1115_capture_put_le(&ui8arr_entry[0], writer->index[c].ui64_offset, 8);
+			ADS1115_capture_put_le(&ui8arr_entry[8], writer->index[c].ui64_first_ns, 8);
+			ADS1115_capture_put_le(&ui8arr_entry[16], writer->index[c].ui64_last_ns, 8);
+			ADS1115_capture_put_le(&ui8arr_entry[24], writer->index[c].ui32_count, 4);
+			ADS1115_capture_put_le(&ui8arr_entry[28], 0, 4);
+			if (fwrite(ui8arr_entry, sizeof(ui8arr_entry), 1, writer->file) != 1) {
+				i_status = ADS1115_ERROR_IO;
+				}
+			}
+		uint8_t ui8arr_trailer[ADS1115_CAPTURE_TRAILER_SIZE];
+		ADS1115_capture_put_le(&ui8arr_trailer[0], writer->ui64_offset, 8);
+		ADS1115_capture_put_le(&ui8arr_trailer[8], writer->ui32_blocks, 4);
+		ADS1115_capture_put_le(&ui8arr_trailer[12], ADS1115_CAPTURE_INDEX_MAGIC, 4);
+		if (i_status == ADS1115_OK && fwrite(ui8arr_trailer, sizeof(ui8arr_trailer), 1, writer->file) != 1) {
+			i_status = ADS1115_ERROR_IO;
+			}
+		}
+	if (fclose(writer->file) != 0 && i_status == ADS1115_OK) {
+		i_status = ADS1115_ERROR_IO;
+		}
+	if (i_status != ADS1115_OK) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_capture_close - %s", strerror(errno));
+		}
+	free(writer->index);
+	free(writer->ui8arr_payload);
+	free(writer);
+	return i_status;
+	}
+
+int ADS1115_capture_load_index(ads1115_capture_reader *reader) {
+	// the index written by ADS1115_capture_close(), when it is intact
+	const uint8_t *ui8arr_map = reader->ui8arr_map;
+	size_t size = reader->size;
+	if (size < ADS1115_CAPTURE_HEADER_SIZE + ADS1115_CAPTURE_TRAILER_SIZE) {
+		return ADS1115_ERROR_INVALID;
+		}
+	const uint8_t *ui8arr_trailer = &ui8arr_map[size - ADS1115_CAPTURE_TRAILER_SIZE];
+	uint64_t ui64_index_offset = ADS1115_capture_get_le(&ui8arr_trailer[0], 8);
+	uint32_t ui32_blocks = ADS1115_capture_get_le(&ui8arr_trailer[8], 4);
+	if (ADS1115_capture_get_le(&ui8arr_trailer[12], 4) != ADS1115_CAPTURE_INDEX_MAGIC) {
+		return ADS1115_ERROR_INVALID;
+		}
+	// the index lies between the header and the trailer and fills that span
+	// exactly, checked so that no field of a torn file can wrap the sum
+	if (ui64_index_offset < ADS1115_CAPTURE_HEADER_SIZE || ui64_index_offset > size - ADS1115_CAPTURE_TRAILER_SIZE) {
+		return ADS1115_ERROR_INVALID;
+		}
+	uint64_t ui64_index_bytes = size - ADS1115_CAPTURE_TRAILER_SIZE - ui64_index_offset;
+	if (ui32_blocks > ui64_index_bytes / ADS1115_CAPTURE_INDEX_SIZE ||
+		(uint64_t)ui32_blocks * ADS1115_CAPTURE_INDEX_SIZE != ui64_index_bytes) {
+		return ADS1115_ERROR_INVALID;
+		}
+
+	reader->index = calloc(ui32_blocks ? ui32_blocks : 1, sizeof(ads1115_capture_index));
+	if (reader->index == NULL) {
+		return ADS1115_ERROR_INVALID;
+		}
+	for (uint32_t c = 0; c < ui32_blocks; c++) {
+		const uint8_t *ui8arr_entry = &ui8arr_map[ui64_index_offset + (uint64_t)c * ADS1115_CAPTURE_INDEX_SIZE];
+		reader->index[c].ui64_offset = ADS1115_capture_get_le(&ui8arr_entry[0], 8);
+		reader->index[c].ui64_first_ns = ADS1115_capture_get_le(&ui8arr_entry[8], 8);
+		reader->index[c].ui64_last_ns = ADS1115_capture_get_le(&ui8arr_entry[16], 8);
+		reader->index[c].ui32_count = ADS1115_capture_get_le(&ui8arr_entry[24], 4);
+		reader->ui64_samples += reader->index[c].ui32_count;
+		}
+	reader->ui32_blocks = ui32_blocks;
+	return ADS1115_OK;
+	}
+
+int ADS1115_capture_scan_index(ads1115_capture_reader *reader) {
+	// no usable trailer, rebuild the index from the block headers and stop at a torn block
+	uint32_t ui32_capacity = 64;
+	reader->index = calloc(ui32_capacity, sizeof(ads1115_capture_index));
+	if (reader->index == NULL) {
+		return ADS1115_ERROR_INVALID;
+		}
+	uint64_t ui64_offset = ADS1115_CAPTURE_HEADER_SIZE;
+	while (ui64_offset + ADS1115_CAPTURE_BLOCK_SIZE <= reader->size) {
+		const uint8_t *ui8arr_block = &reader->ui8arr_map[ui64_offset];
+		uint32_t ui32_payload_bytes = ADS1115_capture_get_le(&ui8arr_block[4], 4);
+		if (ADS1115_capture_get_le(&ui8arr_block[0], 4) != ADS1115_CAPTURE_BLOCK_MAGIC ||
+			ui64_offset + ADS1115_CAPTURE_BLOCK_SIZE + ui32_payload_bytes > reader->size) {
+			break;
+			}
+		if (reader->ui32_blocks == ui32_capacity) {
+			ui32_capacity *= 2;
+			ads1115_capture_index *index = realloc(reader->index, ui32_capacity * sizeof(ads1115_capture_index));
+			if (index == NULL) {
+				return ADS1115_ERROR_INVALID;
+				}
+			reader->index = index;
+			}
+		ads1115_capture_index *entry = &reader->index[reader->ui32_blocks++];
+		entry->ui64_offset = ui64_offset;
+		entry->ui32_count = ADS1115_capture_get_le(&ui8arr_block[8], 4);
+		entry->ui64_first_ns = ADS1115_capture_get_le(&ui8arr_block[16], 8);
+		entry->ui64_last_ns = ADS1115_capture_get_le(&ui8arr_block[24], 8);
+		reader->ui64_samples += entry->ui32_count;
+		ui64_offset += ADS1115_CAPTURE_BLOCK_SIZE + ui32_payload_bytes;
+		}
+	ADS1115_TRACE(ADS1115_TRACE_WARNING, "ADS1115_capture_open - no index, %u blocks recovered", reader->ui32_blocks);
+	return ADS1115_OK;
+	}
+
+int ADS1115_capture_start_block(ads1115_capture_reader *reader, uint32_t ui32_block) {
+	reader->ui32_block = ui32_block;
+	reader->ui32_sample = 0;
+	if (ui32_block >= reader->ui32_blocks) {
+		return ADS1115_OK;
+		}
+	ads1115_capture_index *entry = &reader->index[ui32_block];
+	if (entry->ui64_offset + ADS1115_CAPTURE_BLOCK_SIZE > reader->size) {
+		return ADS1115_ERROR_INVALID;
+		}
+	const uint8_t *ui8arr_block = &reader->ui8arr_map[entry->ui64_offset];
+	uint32_t ui32_payload_bytes = ADS1115_capture_get_le(&ui8arr_block[4], 4);
+	if (ADS1115_capture_get_le(&ui8arr_block[0], 4) != ADS1115_CAPTURE_BLOCK_MAGIC ||
+		entry->ui64_offset + ADS1115_CAPTURE_BLOCK_SIZE + ui32_payload_bytes > reader->size) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_capture - bad block %u", ui32_block);
+		return ADS1115_ERROR_INVALID;
+		}
+	reader->ui8arr_cursor = ui8arr_block + ADS1115_CAPTURE_BLOCK_SIZE;
+	reader->ui8arr_block_end = reader->ui8arr_cursor + ui32_payload_bytes;
+	ADS1115_capture_reset_state(&reader->state, entry->ui64_first_ns);
+	return ADS1115_OK;
+	}
+
+int ADS1115_capture_decode(ads1115_capture_reader *reader, ads1115_sample *sample) {
+	// the next sample of the current block, the inverse of ADS1115_capture_append()
+	ads1115_capture_state *state = &reader->state;
+	const uint8_t *ui8arr_end = reader->ui8arr_block_end;
+	memset(sample, 0, sizeof(ads1115_sample));
+	uint64_t ui64_value;
+	if (ADS1115_capture_get_varint(&reader->ui8arr_cursor, ui8arr_end, &ui64_value) != ADS1115_OK) {
+		return ADS1115_ERROR_INVALID;
+		}
+	state->i64_delta_ns += ADS1115_capture_unzigzag(ui64_value >> 1);
+	state->ui64_timestamp_ns += state->i64_delta_ns;
+	if (ui64_value & 1) {
+		if (ui8arr_end - reader->ui8arr_cursor < 4) {
+			return ADS1115_ERROR_INVALID;
+			}
+		state->ui8_mult_mask = reader->ui8arr_cursor[0];
+		state->ui8_gain_rate_mask = reader->ui8arr_cursor[1];
+		state->ui8_bus_id = reader->ui8arr_cursor[2];
+		state->ui8_address = reader->ui8arr_cursor[3];
+		reader->ui8arr_cursor += 4;
+		}
+	if (ADS1115_capture_get_varint(&reader->ui8arr_cursor, ui8arr_end, &ui64_value) != ADS1115_OK) {
+		return ADS1115_ERROR_INVALID;
+		}
+	uint32_t *ui32p_sequence = ADS1115_capture_sequence(state, state->ui8_bus_id, state->ui8_address);
+	*ui32p_sequence += 1 + (uint32_t)ADS1115_capture_unzigzag(ui64_value);
+	sample->ui32_sequence = *ui32p_sequence;
+	if (reader->ui16_flags & ADS1115_CAPTURE_DELTA) {
+		if (ADS1115_capture_get_varint(&reader->ui8arr_cursor, ui8arr_end, &ui64_value) != ADS1115_OK) {
+			return ADS1115_ERROR_INVALID;
+			}
+		state->i16_code = (int16_t)(state->i16_code + ADS1115_capture_unzigzag(ui64_value));
+		}
+	else {
+		if (ui8arr_end - reader->ui8arr_cursor < 2) {
+			return ADS1115_ERROR_INVALID;
+			}
+		state->i16_code = (int16_t)ADS1115_capture_get_le(reader->ui8arr_cursor, 2);
+		reader->ui8arr_cursor += 2;
+		}
+
+	sample->ui64_timestamp_ns = state->ui64_timestamp_ns;
+	sample->i16_code = state->i16_code;
+	sample->ui8_mult_mask = state->ui8_mult_mask;
+	sample->ui8_pga_mask = state->ui8_gain_rate_mask & 0x0E;
+	sample->ui8_rate_mask = state->ui8_gain_rate_mask & 0xE0;
+	sample->ui8_bus_id = state->ui8_bus_id;
+	sample->ui8_address = state->ui8_address;
+	reader->ui32_sample++;
+	return ADS1115_OK;
+	}
+
+ads1115_capture_reader *ADS1115_capture_open(const char *cp_path) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_capture_open");
+	int i_handle = open(cp_path, O_RDONLY | O_CLOEXEC);
+	if (i_handle < 0) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_capture_open - open: %s", strerror(errno));
+		return NULL;
+		}
+	struct stat st;
+	if (fstat(i_handle, &st) < 0 || st.st_size < ADS1115_CAPTURE_HEADER_SIZE) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_capture_open - not a capture file");
+		close(i_handle);
+		return NULL;
+		}
+	void *vp_map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, i_handle, 0);
+	close(i_handle);
+	if (vp_map == MAP_FAILED) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_capture_open - mmap: %s", strerror(errno));
+		return NULL;
+		}
+
+	ads1115_capture_reader *reader = calloc(1, sizeof(ads1115_capture_reader));
+	if (reader == NULL) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_capture_open - calloc: %s", strerror(errno));
+		munmap(vp_map, st.st_size);
+		return NULL;
+		}
+	reader->ui8arr_map = vp_map;
+	reader->size = st.st_size;
+	reader->ui16_version = ADS1115_capture_get_le(&reader->ui8arr_map[8], 2);
+	reader->ui16_flags = ADS1115_capture_get_le(&reader->ui8arr_map[10], 2);
+	if (memcmp(reader->ui8arr_map, ADS1115_CAPTURE_MAGIC, 8) != 0 ||
+		reader->ui16_version != ADS1115_CAPTURE_VERSION) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_capture_open - not a capture file");
+		ADS1115_capture_release(reader);
+		return NULL;
+		}
+	if (ADS1115_capture_load_index(reader) != ADS1115_OK && ADS1115_capture_scan_index(reader) != ADS1115_OK) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_capture_open - index: %s", strerror(errno));
+		ADS1115_capture_release(reader);
+		return NULL;
+		}
+	ADS1115_capture_start_block(reader, 0);
+	return reader;
+	}
+
+int ADS1115_capture_seek(ads1115_capture_reader *reader, uint64_t ui64_time_ns) {
+	// first block that ends at or after the time, then decode up to the sample
+	uint32_t ui32_low = 0;
+	uint32_t ui32_high = reader->ui32_blocks;
+	while (ui32_low < ui32_high) {
+		uint32_t ui32_mid = ui32_low + (ui32_high - ui32_low) / 2;
+		if (reader->index[ui32_mid].ui64_last_ns < ui64_time_ns) {
+			ui32_low = ui32_mid + 1;
+			}
+		else {
+			ui32_high = ui32_mid;
+			}
+		}
+	int i_status = ADS1115_capture_start_block(reader, ui32_low);
+	if (i_status != ADS1115_OK || ui32_low >= reader->ui32_blocks) {
+		return i_status;
+		}
+
+	ads1115_sample sample;
+	uint32_t ui32_count = reader->index[ui32_low].ui32_count;
+	while (reader->ui32_sample < ui32_count) {
+		// keep the cursor in front of the first sample at or after the time
+		const uint8_t *ui8arr_cursor = reader->ui8arr_cursor;
+		ads1115_capture_state state = reader->state;
+		if (ADS1115_capture_decode(reader, &sample) != ADS1115_OK) {
+			return ADS1115_ERROR_INVALID;
+			}
+		if (sample.ui64_timestamp_ns >= ui64_time_ns) {
+			reader->ui8arr_cursor = ui8arr_cursor;
+			reader->state = state;
+			reader->ui32_sample--;
+			break;
+			}
+		}
+	return ADS1115_OK;
+	}
+
+int ADS1115_capture_read(ads1115_capture_reader *reader, ads1115_sample *samples, int max) {
+	// decode up to max samples from the cursor on, 0 at the end of the file
+	int i_total = 0;
+	while (i_total < max && reader->ui32_block < reader->ui32_blocks) {
+		if (reader->ui32_sample == reader->index[reader->ui32_block].ui32_count) {
+			if (ADS1115_capture_start_block(reader, reader->ui32_block + 1) != ADS1115_OK) {
+				return (i_total > 0) ? i_total : ADS1115_ERROR_INVALID;
+				}
+			continue;
+			}
+		if (ADS1115_capture_decode(reader, &samples[i_total]) != ADS1115_OK) {
+			ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_capture_read - corrupt block %u", reader->ui32_block);
+			return (i_total > 0) ? i_total : ADS1115_ERROR_INVALID;
+			}
+		i_total++;
+		}
+	return i_total;
+	}
+
+void ADS1115_capture_release(ads1115_capture_reader *reader) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_capture_release");
+	munmap((void *)reader->ui8arr_map, reader->size);
+	free(reader->index);
+	free(reader);
+	}
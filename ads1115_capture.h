@@ -0,0 +1,147 @@
+/* File:		ads1115_capture.h
+ * Purpose: 	compact binary capture files for ads1115_sample streams
+ *
+ * Preface:		ads1115_capture.h - a writer that appends raw samples to
+ * 				a block structured file, and a reader that maps the file
+ * 				and seeks by time through a per-block index.
+ *
+ * 				File layout, all integers little-endian:
+ *
+ * 				header		"ADS1115C", u16 version, u16 flags,
+ * 							u32 samples per block
+ * 				block...	u32 "ADSB", u32 payload bytes, u32 samples,
+ * 							u32 reserved, u64 first and u64 last timestamp,
+ * 							then the payload
+ * 				index		one entry per block: u64 file offset,
+ * 							u64 first and u64 last timestamp, u32 samples,
+ * 							u32 reserved
+ * 				trailer		u64 index offset, u32 blocks, u32 "ADSI"
+ *
+ * 				Each sample in a payload is a varint of the zigzag coded
+ * 				change in timestamp delta (so a steady data rate costs a
+ * 				byte or two), shifted left by one with bit 0 set when a
+ * 				4 byte tag follows: the MULT_MASK, the PGA_MASK and
+ * 				RATE_MASK or'd together, the bus id and the address. The
+ * 				tag is only written when it changes. Next comes a zigzag
+ * 				varint of the sequence number less the one expected for
+ * 				that device (its previous one plus one), a single zero
+ * 				byte while nothing is lost; the coder remembers the last
+ * 				ADS1115_CAPTURE_DEVICES devices of the block. The code
+ * 				follows as 2 raw bytes, or with ADS1115_CAPTURE_DELTA as
+ * 				a zigzag varint of the change from the previous code.
+ * 				Every block starts from zero state and decodes on its own.
+ *
+ * 				The index and trailer are written by ADS1115_capture_close();
+ * 				a file from a run that never closed is still readable,
+ * 				the reader then walks the block headers instead. Each
+ * 				block is flushed to the file as soon as it fills, so a
+ * 				crash loses at most the block in progress.
+ * */
+#ifndef ADS1115_CAPTURE_H
+#define ADS1115_CAPTURE_H
+
+#include "ads1115.h"
+#include <sys/mman.h>		// mmap(), munmap()
+#include <sys/stat.h>		// fstat()
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+//DEFINE****************************************************************
+#define ADS1115_CAPTURE_MAGIC			"ADS1115C"
+#define ADS1115_CAPTURE_VERSION			1
+#define ADS1115_CAPTURE_BLOCK_MAGIC		0x42534441		// "ADSB"
+#define ADS1115_CAPTURE_INDEX_MAGIC		0x49534441		// "ADSI"
+#define ADS1115_CAPTURE_HEADER_SIZE		16
+#define ADS1115_CAPTURE_BLOCK_SIZE		32
+#define ADS1115_CAPTURE_INDEX_SIZE		32
+#define ADS1115_CAPTURE_TRAILER_SIZE	16
+#define ADS1115_CAPTURE_BLOCK_SAMPLES	4096
+
+// worst case encoded sample: 10 byte varint, 4 byte tag, 5 byte sequence, 3 byte code
+#define ADS1115_CAPTURE_SAMPLE_MAX		22
+
+// devices whose sequence numbers the coder follows at once
+#define ADS1115_CAPTURE_DEVICES			16
+
+enum ADS1115_CAPTURE_FLAGS {
+	ADS1115_CAPTURE_RAW = 0,
+	ADS1115_CAPTURE_DELTA = 1
+	};
+
+typedef struct ads1115_capture_index {
+	uint64_t ui64_offset;
+	uint64_t ui64_first_ns;
+	uint64_t ui64_last_ns;
+	uint32_t ui32_count;
+	} ads1115_capture_index;
+
+// coder state, reset at the start of every block
+typedef struct ads1115_capture_state {
+	uint64_t ui64_timestamp_ns;
+	int64_t i64_delta_ns;
+	int16_t i16_code;
+	uint8_t ui8_mult_mask;
+	uint8_t ui8_gain_rate_mask;
+	uint8_t ui8_bus_id;
+	uint8_t ui8_address;
+	uint8_t ui8_tagged;
+
+	// last sequence number per bus id << 8 | address, oldest replaced first
+	uint16_t ui16arr_device[ADS1115_CAPTURE_DEVICES];
+	uint32_t ui32arr_sequence[ADS1115_CAPTURE_DEVICES];
+	uint8_t ui8_devices;
+	uint8_t ui8_replace;
+	} ads1115_capture_state;
+
+typedef struct ads1115_capture_writer {
+	FILE *file;
+	uint16_t ui16_flags;
+	uint32_t ui32_block_samples;
+
+	// block being filled
+	uint8_t *ui8arr_payload;
+	uint32_t ui32_payload_bytes;
+	uint32_t ui32_count;
+	uint64_t ui64_first_ns;
+	ads1115_capture_state state;
+
+	// index of the blocks written so far
+	ads1115_capture_index *index;
+	uint32_t ui32_blocks;
+	uint32_t ui32_index_capacity;
+	uint64_t ui64_offset;
+	} ads1115_capture_writer;
+
+typedef struct ads1115_capture_reader {
+	const uint8_t *ui8arr_map;
+	size_t size;
+	uint16_t ui16_version;
+	uint16_t ui16_flags;
+	ads1115_capture_index *index;
+	uint32_t ui32_blocks;
+	uint64_t ui64_samples;
+
+	// read cursor
+	uint32_t ui32_block;
+	uint32_t ui32_sample;
+	const uint8_t *ui8arr_cursor;
+	const uint8_t *ui8arr_block_end;
+	ads1115_capture_state state;
+	} ads1115_capture_reader;
+//**********************************************************************
+//PROTOTYPE*************************************************************
+ads1115_capture_writer *ADS1115_capture_create(const char *cp_path, enum ADS1115_CAPTURE_FLAGS flags, uint32_t ui32_block_samples);
+int ADS1115_capture_append(ads1115_capture_writer *writer, const ads1115_sample *samples, int count);
+int ADS1115_capture_flush(ads1115_capture_writer *writer);
+int ADS1115_capture_close(ads1115_capture_writer *writer);
+
+ads1115_capture_reader *ADS1115_capture_open(const char *cp_path);
+int ADS1115_capture_seek(ads1115_capture_reader *reader, uint64_t ui64_time_ns);
+int ADS1115_capture_read(ads1115_capture_reader *reader, ads1115_sample *samples, int max);
+void ADS1115_capture_release(ads1115_capture_reader *reader);
+//**********************************************************************
+#ifdef __cplusplus
+}
+#endif
+#endif
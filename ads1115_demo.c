@@ -11,16 +11,26 @@
 
 int main(int argc, char **argv) {	
 	
-	ADS1115_init(1, SDA);	
-	ADS1115_set_pga(PGA_4_096);
-	ADS1115_set_conversion_rate(SPS_16);
-	ADS1115_set_multiplex(MULT_AIN_0);
+	// the library is silent by default, show its setup messages on stderr
+	ADS1115_set_trace_sink(NULL, NULL, ADS1115_TRACE_INFO);
+	
+	ads1115_dev *dev = ADS1115_init(1, SDA);	
+	if (dev == NULL) {
+		return 1;
+		}
+	ADS1115_set_pga(dev, PGA_4_096);
+	ADS1115_set_conversion_rate(dev, SPS_16);
+	ADS1115_set_multiplex(dev, MULT_AIN_0);
 	
 	double darr_data[10] = {0};
 	double d_temp = 0;
 	for (int c = 0; c < 10; c++) {
-		darr_data[c] = ADS1115_get_average_conversions(8);		
+		if (ADS1115_get_average_conversions(dev, 8, &darr_data[c]) != ADS1115_OK) {
+			break;
+			}
+		printf("average = %1.4f (V)\n", darr_data[c]);
 		}		
+	ADS1115_close(dev);
 	return 0;
 	}
 
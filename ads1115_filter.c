@@ -0,0 +1,222 @@
+/* File:		ads1115_filter.c
+ * Purpose: 	streaming filter and decimation stage for ads1115.c
+ *
+ * Preface:		see ads1115_filter.h. Sums are kept in integers so the
+ * 				moving average does not drift however long it runs.
+ * */
+#include "ads1115_filter.h"
+
+ads1115_filter *ADS1115_filter_create(enum ADS1115_FILTER_TYPE type, int i_window, int i_decimation) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_filter_create");
+	if (i_window < 1 || i_decimation < 1) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_filter_create - window %d, decimation %d", i_window, i_decimation);
+		return NULL;
+		}
+	ads1115_filter *filter = calloc(1, sizeof(ads1115_filter));
+	if (filter == NULL) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_filter_create - calloc: %s", strerror(errno));
+		return NULL;
+		}
+	filter->type = type;
+	filter->i_window = i_window;
+	filter->i_decimation = i_decimation;
+
+	switch(type) {
+		case FILTER_MEDIAN:
+			filter->i16arr_sorted = calloc(i_window, sizeof(int16_t));
+			// fall through - the median also keeps the history
+		case FILTER_MOVING_AVERAGE:
+			filter->i16arr_history = calloc(i_window, sizeof(int16_t));
+			if (filter->i16arr_history == NULL || (type == FILTER_MEDIAN && filter->i16arr_sorted == NULL)) {
+				ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_filter_create - calloc: %s", strerror(errno));
+				ADS1115_filter_destroy(filter);
+				return NULL;
+				}
+			break;
+		case FILTER_EMA:
+			filter->d_alpha = 2.0 / (i_window + 1);
+			break;
+		case FILTER_BOXCAR:
+			filter->i_window = i_decimation;
+			break;
+		case FILTER_CIC:
+			filter->i_window = i_decimation;
+			filter->d_cic_gain = 1.0;
+			for (int c = 0; c < ADS1115_FILTER_CIC_ORDER; c++) {
+				filter->d_cic_gain *= i_decimation;
+				}
+			break;
+		default:
+			ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_filter_create - unknown type %d", type);
+			ADS1115_filter_destroy(filter);
+			return NULL;
+		}
+	ADS1115_filter_reset(filter);
+	return filter;
+	}
+
+void ADS1115_filter_reset(ads1115_filter *filter) {
+	// forget all history, e.g. after a gain or channel change
+	filter->i_phase = 0;
+	filter->i_head = 0;
+	filter->i_fill = 0;
+	filter->i64_sum = 0;
+	filter->d_state = 0;
+	memset(filter->ui64arr_integrator, 0, sizeof(filter->ui64arr_integrator));
+	memset(filter->ui64arr_comb, 0, sizeof(filter->ui64arr_comb));
+	}
+
+void ADS1115_filter_median_insert(ads1115_filter *filter, int16_t i16_code) {
+	// drop the code leaving the window from the sorted copy, then insert the new one
+	int16_t *i16arr_sorted = filter->i16arr_sorted;
+	int i_count = filter->i_fill;
+	if (i_count == filter->i_window) {
+		int16_t i16_oldest = filter->i16arr_history[filter->i_head];
+		int i_low = 0;
+		int i_high = i_count - 1;
+		while (i_low < i_high) {
+			int i_mid = (i_low + i_high) / 2;
+			if (i16arr_sorted[i_mid] < i16_oldest) {
+				i_low = i_mid + 1;
+				}
+			else {
+				i_high = i_mid;
+				}
+			}
+		memmove(&i16arr_sorted[i_low], &i16arr_sorted[i_low + 1], (i_count - i_low - 1) * sizeof(int16_t));
+		i_count--;
+		}
+	int i_position = i_count;
+	while (i_position > 0 && i16arr_sorted[i_position - 1] > i16_code) {
+		i16arr_sorted[i_position] = i16arr_sorted[i_position - 1];
+		i_position--;
+		}
+	i16arr_sorted[i_position] = i16_code;
+	}
+
+int ADS1115_filter_process(ads1115_filter *filter, const int16_t *i16arr_codes, int count, double *darr_output) {
+	// feed count codes, returns the number of outputs written to darr_output
+	int i_outputs = 0;
+	for (int c = 0; c < count; c++) {
+		int16_t i16_code = i16arr_codes[c];
+		int i_ready = 1;
+
+		switch(filter->type) {
+			case FILTER_MEDIAN:
+				ADS1115_filter_median_insert(filter, i16_code);
+				// fall through - the history ring is shared with the moving average
+			case FILTER_MOVING_AVERAGE:
+				if (filter->i_fill == filter->i_window) {
+					filter->i64_sum -= filter->i16arr_history[filter->i_head];
+					}
+				else {
+					filter->i_fill++;
+					}
+				filter->i64_sum += i16_code;
+				filter->i16arr_history[filter->i_head] = i16_code;
+				filter->i_head = (filter->i_head + 1 < filter->i_window) ? filter->i_head + 1 : 0;
+				i_ready = (filter->i_fill == filter->i_window);
+				break;
+			case FILTER_EMA:
+				if (filter->i_fill == 0) {
+					filter->d_state = i16_code;
+					filter->i_fill = 1;
+					}
+				else {
+					filter->d_state += filter->d_alpha * (i16_code - filter->d_state);
+					}
+				break;
+			case FILTER_BOXCAR:
+				filter->i64_sum += i16_code;
+				break;
+			case FILTER_CIC:
+				filter->ui64arr_integrator[0] += (uint64_t)(int64_t)i16_code;
+				for (int s = 1; s < ADS1115_FILTER_CIC_ORDER; s++) {
+					filter->ui64arr_integrator[s] += filter->ui64arr_integrator[s - 1];
+					}
+				break;
+			}
+
+		if (++filter->i_phase < filter->i_decimation) {
+			continue;
+			}
+		filter->i_phase = 0;
+
+		double d_output = 0;
+		switch(filter->type) {
+			case FILTER_MOVING_AVERAGE:
+				d_output = (double)filter->i64_sum / filter->i_window;
+				break;
+			case FILTER_MEDIAN: {
+				int i_middle = filter->i_window / 2;
+				if (filter->i_window & 1) {
+					d_output = filter->i16arr_sorted[i_middle];
+					}
+				else {
+					d_output = (filter->i16arr_sorted[i_middle - 1] + filter->i16arr_sorted[i_middle]) / 2.0;
+					}
+				break;
+				}
+			case FILTER_EMA:
+				d_output = filter->d_state;
+				break;
+			case FILTER_BOXCAR:
+				d_output = (double)filter->i64_sum / filter->i_decimation;
+				filter->i64_sum = 0;
+				break;
+			case FILTER_CIC: {
+				// combs run at the output rate with a delay of one output
+				uint64_t ui64_value = filter->ui64arr_integrator[ADS1115_FILTER_CIC_ORDER - 1];
+				for (int s = 0; s < ADS1115_FILTER_CIC_ORDER; s++) {
+					uint64_t ui64_delayed = filter->ui64arr_comb[s];
+					filter->ui64arr_comb[s] = ui64_value;
+					ui64_value -= ui64_delayed;
+					}
+				d_output = (int64_t)ui64_value / filter->d_cic_gain;
+				// the impulse response spans ORDER outputs, skip the start-up transient
+				if (filter->i_fill < ADS1115_FILTER_CIC_ORDER) {
+					filter->i_fill++;
+					}
+				i_ready = (filter->i_fill == ADS1115_FILTER_CIC_ORDER);
+				break;
+				}
+			}
+		if (i_ready) {
+			darr_output[i_outputs++] = d_output;
+			}
+		}
+	return i_outputs;
+	}
+
+int ADS1115_filter_read_stream(ads1115_dev *dev, ads1115_filter *filter, double *darr_volts, int count) {
+	// pull raw codes from the device until count filtered values are out
+	int16_t i16arr_chunk[ADS1115_STREAM_CHUNK];
+	int i_total = 0;
+	while (i_total < count) {
+		// never read more than can produce the outputs still wanted
+		int i_wanted = (count - i_total) * filter->i_decimation - filter->i_phase;
+		if (i_wanted > ADS1115_STREAM_CHUNK) {
+			i_wanted = ADS1115_STREAM_CHUNK;
+			}
+		int i_read = ADS1115_read_stream_raw(dev, i16arr_chunk, i_wanted);
+		if (i_read < 0) {
+			return (i_total > 0) ? i_total : i_read;
+			}
+		int i_produced = ADS1115_filter_process(filter, i16arr_chunk, i_read, &darr_volts[i_total]);
+		for (int c = i_total; c < i_total + i_produced; c++) {
+			darr_volts[c] *= dev->f_resolution;
+			}
+		i_total += i_produced;
+		if (i_read < i_wanted) {
+			break;
+			}
+		}
+	return i_total;
+	}
+
+void ADS1115_filter_destroy(ads1115_filter *filter) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_filter_destroy");
+	free(filter->i16arr_history);
+	free(filter->i16arr_sorted);
+	free(filter);
+	}
@@ -0,0 +1,82 @@
+/* File:		ads1115_filter.h
+ * Purpose: 	streaming filter and decimation stage for ads1115.c
+ *
+ * Preface:		ads1115_filter.h - smooths a stream of raw conversion
+ * 				codes one sample at a time and emits an output every
+ * 				i_decimation inputs, so filtered values keep coming while
+ * 				the raw stream flows instead of stalling the caller for a
+ * 				whole window. Filters run on integer codes; outputs are
+ * 				codes as doubles (an average can fall between two codes),
+ * 				scale them with ADS1115_get_pga_resolution().
+ *
+ * 				FILTER_MOVING_AVERAGE	mean of the last i_window codes, O(1)
+ * 				FILTER_EMA				exponential smoothing with
+ * 										alpha = 2 / (i_window + 1), O(1)
+ * 				FILTER_BOXCAR			mean of each block of i_decimation
+ * 										codes (sum and dump), O(1)
+ * 				FILTER_CIC				ADS1115_FILTER_CIC_ORDER stage CIC
+ * 										decimator by i_decimation, unity
+ * 										gain, O(order)
+ * 				FILTER_MEDIAN			median of the last i_window codes,
+ * 										O(i_window) for the sorted insert
+ *
+ * 				BOXCAR and CIC ignore i_window, their block is the
+ * 				decimation ratio. The moving average and median only emit
+ * 				once their window has filled; the CIC once its comb
+ * 				delays have.
+ * */
+#ifndef ADS1115_FILTER_H
+#define ADS1115_FILTER_H
+
+#include "ads1115.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+//DEFINE****************************************************************
+#define ADS1115_FILTER_CIC_ORDER	3
+
+enum ADS1115_FILTER_TYPE {
+	FILTER_MOVING_AVERAGE,
+	FILTER_EMA,
+	FILTER_BOXCAR,
+	FILTER_CIC,
+	FILTER_MEDIAN
+	};
+
+typedef struct ads1115_filter {
+	enum ADS1115_FILTER_TYPE type;
+	int i_window;
+	int i_decimation;
+	int i_phase;					// inputs since the last output
+
+	// moving average and median history, a ring of the last i_window codes
+	int16_t *i16arr_history;
+	int i_head;
+	int i_fill;
+	int64_t i64_sum;
+
+	// median, the history kept sorted
+	int16_t *i16arr_sorted;
+
+	// exponential smoothing
+	double d_alpha;
+	double d_state;
+
+	// CIC -- unsigned so integrator wrap-around is defined, the combs undo it
+	uint64_t ui64arr_integrator[ADS1115_FILTER_CIC_ORDER];
+	uint64_t ui64arr_comb[ADS1115_FILTER_CIC_ORDER];
+	double d_cic_gain;
+	} ads1115_filter;
+//**********************************************************************
+//PROTOTYPE*************************************************************
+ads1115_filter *ADS1115_filter_create(enum ADS1115_FILTER_TYPE type, int i_window, int i_decimation);
+void ADS1115_filter_reset(ads1115_filter *filter);
+int ADS1115_filter_process(ads1115_filter *filter, const int16_t *i16arr_codes, int count, double *darr_output);
+int ADS1115_filter_read_stream(ads1115_dev *dev, ads1115_filter *filter, double *darr_volts, int count);
+void ADS1115_filter_destroy(ads1115_filter *filter);
+//**********************************************************************
+#ifdef __cplusplus
+}
+#endif
+#endif
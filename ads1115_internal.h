@@ -0,0 +1,30 @@
+/* File:		ads1115_internal.h
+ * Purpose: 	helpers shared between the ads1115 translation units
+ *
+ * Preface:		ads1115_internal.h - oscillator drift learning, sample
+ * 				tagging and latency bookkeeping for ads1115.c,
+ * 				ads1115_async.c and ads1115_acq.c. Not part of the
+ * 				public API; applications read the learned clock through
+ * 				ADS1115_get_clock_ratio() and
+ * 				ADS1115_get_sample_period_ns().
+ * */
+#ifndef ADS1115_INTERNAL_H
+#define ADS1115_INTERNAL_H
+
+#include "ads1115.h"
+
+//PROTOTYPE*************************************************************
+double ADS1115_drift_ratio(ads1115_dev *dev, uint8_t ui8_rate_mask);
+long ADS1115_drift_single_ns(ads1115_dev *dev, uint8_t ui8_rate_mask);
+long ADS1115_drift_first_poll_ns(ads1115_dev *dev, uint8_t ui8_rate_mask);
+uint64_t ADS1115_drift_done(ads1115_dev *dev, uint8_t ui8_rate_mask, uint64_t ui64_start, uint64_t ui64_seen, int i_first_poll);
+double ADS1115_drift_blend(double d_learned, double d_measured, uint16_t ui16_count);
+void ADS1115_drift_set(ads1115_dev *dev, uint8_t ui8_rate_mask, double d_ratio);
+void ADS1115_drift_single(ads1115_dev *dev, uint8_t ui8_rate_mask, uint64_t ui64_latency_ns);
+void ADS1115_drift_busy(ads1115_dev *dev, uint8_t ui8_rate_mask, uint64_t ui64_start, uint64_t ui64_seen);
+void ADS1115_drift_edge(ads1115_dev *dev, uint8_t ui8_rate_mask, uint64_t ui64_interval_ns);
+void ADS1115_tag_sample(ads1115_dev *dev, ads1115_sample *sample, uint64_t ui64_timestamp_ns, int16_t i16_code);
+int ADS1115_ready_wait_enabled(ads1115_dev *dev);
+void ADS1115_record_latency(ads1115_dev *dev, uint64_t ui64_latency_ns);
+//**********************************************************************
+#endif
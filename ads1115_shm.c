@@ -0,0 +1,196 @@
+/* File:		ads1115_shm.c
+ * Purpose: 	publishes ads1115_sample streams to other processes through
+ * 				POSIX shared memory
+ *
+ * Preface:		see ads1115_shm.h. The ring relies on lock-free 64 bit
+ * 				atomics, which work across processes where plain loads and
+ * 				stores are; both ends check for them. A publisher that
+ * 				replaces an object still in use unlinks it first, so
+ * 				readers left on it see no new samples and must attach again.
+ * */
+#define _GNU_SOURCE			// ftruncate() under -std=c11
+#include "ads1115_shm.h"
+
+int ADS1115_shm_lock_free() {
+	_Atomic uint64_t ui64_probe = 0;
+	if (!atomic_is_lock_free(&ui64_probe)) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_shm - 64 bit atomics are not lock-free here");
+		return 0;
+		}
+	return 1;
+	}
+
+ads1115_shm_publisher *ADS1115_shm_create(const char *cp_name, uint32_t ui32_capacity, enum ADS1115_SHM_FLAGS flags) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_shm_create");
+	if (!ADS1115_shm_lock_free()) {
+		return NULL;
+		}
+	if (ui32_capacity > ADS1115_SHM_CAPACITY_MAX) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_shm_create - capacity %u over %u", ui32_capacity, ADS1115_SHM_CAPACITY_MAX);
+		return NULL;
+		}
+	uint32_t ui32_size = 2;
+	while (ui32_size < ui32_capacity) {
+		ui32_size <<= 1;
+		}
+	ads1115_shm_publisher *publisher = calloc(1, sizeof(ads1115_shm_publisher));
+	if (publisher == NULL) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_shm_create - calloc: %s", strerror(errno));
+		return NULL;
+		}
+	snprintf(publisher->carr_name, sizeof(publisher->carr_name), "%s", cp_name);
+	publisher->size = sizeof(ads1115_shm_header) + (size_t)ui32_size * sizeof(ads1115_shm_slot);
+
+	// start from a fresh, zero filled object -- every slot sequence reads as never written
+	if (flags & ADS1115_SHM_REPLACE) {
+		shm_unlink(publisher->carr_name);
+		}
+	int fd = shm_open(publisher->carr_name, O_CREAT | O_EXCL | O_RDWR, 0644);
+	if (fd < 0) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_shm_create - shm_open(%s): %s", publisher->carr_name, strerror(errno));
+		free(publisher);
+		return NULL;
+		}
+	struct stat st;
+	if (fstat(fd, &st) < 0 || ftruncate(fd, publisher->size) < 0) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_shm_create - fstat/ftruncate: %s", strerror(errno));
+		close(fd);
+		shm_unlink(publisher->carr_name);
+		free(publisher);
+		return NULL;
+		}
+	publisher->ui64_inode = st.st_ino;
+	void *map = mmap(NULL, publisher->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_shm_create - mmap: %s", strerror(errno));
+		shm_unlink(publisher->carr_name);
+		free(publisher);
+		return NULL;
+		}
+	publisher->header = map;
+	publisher->header->ui32_version = ADS1115_SHM_VERSION;
+	publisher->header->ui32_capacity = ui32_size;
+	publisher->header->ui32_slot_size = sizeof(ads1115_shm_slot);
+	atomic_store_explicit(&publisher->header->ui32_magic, ADS1115_SHM_MAGIC, memory_order_release);
+	return publisher;
+	}
+
+void ADS1115_shm_publish(ads1115_shm_publisher *publisher, const ads1115_sample *samples, int count) {
+	// never blocks, readers that fell a ring behind lose the oldest samples
+	ads1115_shm_header *header = publisher->header;
+	uint32_t ui32_mask = header->ui32_capacity - 1;
+	for (int c = 0; c < count; c++) {
+		uint64_t ui64_n = publisher->ui64_head++;
+		ads1115_shm_slot *slot = &header->slots[ui64_n & ui32_mask];
+		atomic_store_explicit(&slot->ui64_sequence, 2 * ui64_n + 1, memory_order_relaxed);
+		atomic_thread_fence(memory_order_release);
+		slot->sample = samples[c];
+		atomic_store_explicit(&slot->ui64_sequence, 2 * ui64_n + 2, memory_order_release);
+		}
+	atomic_store_explicit(&header->ui64_head, publisher->ui64_head, memory_order_release);
+	}
+
+void ADS1115_shm_destroy(ads1115_shm_publisher *publisher) {
+	// readers still attached keep their mapping until they detach
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_shm_destroy");
+	munmap(publisher->header, publisher->size);
+	int fd = shm_open(publisher->carr_name, O_RDONLY, 0);
+	if (fd >= 0) {
+		struct stat st;
+		if (fstat(fd, &st) == 0 && st.st_ino == publisher->ui64_inode) {
+			shm_unlink(publisher->carr_name);
+			}
+		close(fd);
+		}
+	free(publisher);
+	}
+
+ads1115_shm_reader *ADS1115_shm_attach(const char *cp_name) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_shm_attach");
+	if (!ADS1115_shm_lock_free()) {
+		return NULL;
+		}
+	int fd = shm_open(cp_name, O_RDONLY, 0);
+	if (fd < 0) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_shm_attach - shm_open(%s): %s", cp_name, strerror(errno));
+		return NULL;
+		}
+	struct stat st;
+	if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(ads1115_shm_header)) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_shm_attach - %s is not a sample ring", cp_name);
+		close(fd);
+		return NULL;
+		}
+	void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_shm_attach - mmap: %s", strerror(errno));
+		return NULL;
+		}
+
+	// the magic goes in last, a ring still being set up is refused
+	const ads1115_shm_header *header = map;
+	if (atomic_load_explicit(&header->ui32_magic, memory_order_acquire) != ADS1115_SHM_MAGIC ||
+		header->ui32_version != ADS1115_SHM_VERSION ||
+		header->ui32_slot_size != sizeof(ads1115_shm_slot) ||
+		header->ui32_capacity > ADS1115_SHM_CAPACITY_MAX ||
+		(size_t)st.st_size != sizeof(ads1115_shm_header) + (size_t)header->ui32_capacity * sizeof(ads1115_shm_slot)) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_shm_attach - %s: bad header", cp_name);
+		munmap(map, st.st_size);
+		return NULL;
+		}
+	ads1115_shm_reader *reader = calloc(1, sizeof(ads1115_shm_reader));
+	if (reader == NULL) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_shm_attach - calloc: %s", strerror(errno));
+		munmap(map, st.st_size);
+		return NULL;
+		}
+	reader->header = header;
+	reader->size = st.st_size;
+
+	// a new reader starts with the next sample published
+	reader->ui64_cursor = atomic_load_explicit(&header->ui64_head, memory_order_acquire);
+	return reader;
+	}
+
+int ADS1115_shm_read(ads1115_shm_reader *reader, ads1115_sample *samples, int max) {
+	// copies out up to max samples in publication order, returns the count
+	const ads1115_shm_header *header = reader->header;
+	uint64_t ui64_capacity = header->ui32_capacity;
+	uint64_t ui64_head = atomic_load_explicit(&header->ui64_head, memory_order_acquire);
+	int i_count = 0;
+	while (i_count < max && reader->ui64_cursor < ui64_head) {
+		// lapped by the publisher, jump to the oldest sample still in the ring
+		if (ui64_head - reader->ui64_cursor > ui64_capacity) {
+			reader->ui64_lost += ui64_head - ui64_capacity - reader->ui64_cursor;
+			reader->ui64_cursor = ui64_head - ui64_capacity;
+			}
+		const ads1115_shm_slot *slot = &header->slots[reader->ui64_cursor & (ui64_capacity - 1)];
+		uint64_t ui64_expected = 2 * reader->ui64_cursor + 2;
+		if (atomic_load_explicit(&slot->ui64_sequence, memory_order_acquire) == ui64_expected) {
+			ads1115_sample sample = slot->sample;
+			atomic_thread_fence(memory_order_acquire);
+			if (atomic_load_explicit(&slot->ui64_sequence, memory_order_relaxed) == ui64_expected) {
+				samples[i_count++] = sample;
+				reader->ui64_cursor++;
+				continue;
+				}
+			}
+		// the slot moved on while it was copied, this sample is gone
+		reader->ui64_lost++;
+		reader->ui64_cursor++;
+		ui64_head = atomic_load_explicit(&header->ui64_head, memory_order_acquire);
+		}
+	return i_count;
+	}
+
+uint64_t ADS1115_shm_get_lost(ads1115_shm_reader *reader) {
+	return reader->ui64_lost;
+	}
+
+void ADS1115_shm_detach(ads1115_shm_reader *reader) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_shm_detach");
+	munmap((void *)reader->header, reader->size);
+	free(reader);
+	}
@@ -0,0 +1,103 @@
+/* File:		ads1115_shm.h
+ * Purpose: 	publishes ads1115_sample streams to other processes through
+ * 				POSIX shared memory
+ *
+ * Preface:		ads1115_shm.h - one acquisition process publishes samples
+ * 				into a ring in a shm_open() object; any number of local
+ * 				readers attach to it by name and read without syscalls,
+ * 				locks or copies through the kernel. A reader maps the ring
+ * 				read only and cannot disturb the publisher or other readers.
+ *
+ * 				Every slot carries a sequence word, a seqlock of its own:
+ * 				the publisher makes it odd while it writes the slot and
+ * 				then sets it to 2 * (n + 1) for the n-th sample published.
+ * 				A reader wanting sample n checks for exactly that value
+ * 				before and after copying the slot, so it never returns a
+ * 				torn or recycled sample. The publisher never waits for
+ * 				readers -- a reader more than a ring behind skips ahead
+ * 				and counts what it missed as lost.
+ *
+ * 				Names follow shm_open(): a leading '/' and no other. The
+ * 				object stays until the publisher is destroyed. A name
+ * 				still in use, e.g. left behind by a publisher that
+ * 				crashed, is refused unless ADS1115_SHM_REPLACE is given.
+ * 				Link with -lrt on glibc older than 2.17.
+ * */
+#ifndef ADS1115_SHM_H
+#define ADS1115_SHM_H
+
+#include "ads1115.h"
+#ifndef __cplusplus
+#include <stdatomic.h>		// _Atomic, atomic_load_explicit(), ect.
+#endif
+#include <sys/mman.h>		// shm_open(), mmap()
+#include <sys/stat.h>		// fstat(), mode constants
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+//DEFINE****************************************************************
+#define ADS1115_SHM_MAGIC		0x4D485341		// "ASHM"
+#define ADS1115_SHM_VERSION		1
+
+// slots in a ring at most, the slot array stays within a 32 bit size_t
+#define ADS1115_SHM_CAPACITY_MAX	(1u << 24)
+
+// NAME_MAX and the terminator, without depending on the feature macros of the includer
+#define ADS1115_SHM_NAME_MAX	256
+
+enum ADS1115_SHM_FLAGS {
+	ADS1115_SHM_EXCLUSIVE = 0,
+	ADS1115_SHM_REPLACE = 1				// unlink an object already under the name
+	};
+
+#ifndef __cplusplus
+typedef struct ads1115_shm_slot {
+	_Atomic uint64_t ui64_sequence;
+	ads1115_sample sample;
+	} ads1115_shm_slot;
+
+// the mapped object, the slots follow the header
+typedef struct ads1115_shm_header {
+	_Atomic uint32_t ui32_magic;			// written last, once the rest is set up
+	uint32_t ui32_version;
+	uint32_t ui32_capacity;					// a power of two
+	uint32_t ui32_slot_size;				// readers built with another layout refuse it
+	_Alignas(ADS1115_CACHE_LINE) _Atomic uint64_t ui64_head;	// samples published so far
+	_Alignas(ADS1115_CACHE_LINE) ads1115_shm_slot slots[];
+	} ads1115_shm_header;
+
+typedef struct ads1115_shm_publisher {
+	char carr_name[ADS1115_SHM_NAME_MAX];
+	uint64_t ui64_inode;				// a replacement under the same name is not ours to unlink
+	ads1115_shm_header *header;
+	size_t size;
+	uint64_t ui64_head;
+	} ads1115_shm_publisher;
+
+typedef struct ads1115_shm_reader {
+	const ads1115_shm_header *header;
+	size_t size;
+	uint64_t ui64_cursor;					// next sample this reader wants
+	uint64_t ui64_lost;
+	} ads1115_shm_reader;
+#else
+// _Atomic and _Alignas are C only, C++ sees the handles through pointers
+typedef struct ads1115_shm_publisher ads1115_shm_publisher;
+typedef struct ads1115_shm_reader ads1115_shm_reader;
+#endif
+//**********************************************************************
+//PROTOTYPE*************************************************************
+ads1115_shm_publisher *ADS1115_shm_create(const char *cp_name, uint32_t ui32_capacity, enum ADS1115_SHM_FLAGS flags);
+void ADS1115_shm_publish(ads1115_shm_publisher *publisher, const ads1115_sample *samples, int count);
+void ADS1115_shm_destroy(ads1115_shm_publisher *publisher);
+
+ads1115_shm_reader *ADS1115_shm_attach(const char *cp_name);
+int ADS1115_shm_read(ads1115_shm_reader *reader, ads1115_sample *samples, int max);
+uint64_t ADS1115_shm_get_lost(ads1115_shm_reader *reader);
+void ADS1115_shm_detach(ads1115_shm_reader *reader);
+//**********************************************************************
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,460 @@
+/* File:		ads1115_sim.c
+ * Purpose: 	in-process ADS1115 simulator, a transport backend for ads1115.c
+ *
+ * Preface:		see ads1115_sim.h. Chip state only advances when the bus is
+ * 				accessed; each access first latches every conversion that
+ * 				would have completed by then, sampling the inputs at the
+ * 				time the conversion ended. Once an alert fd is handed out
+ * 				a bus thread does the same at every conversion boundary,
+ * 				so the comparator runs without bus traffic.
+ * */
+#define _GNU_SOURCE			// M_PI, nanosleep(), pthread_condattr_setclock() under -std=c11
+#include "ads1115_sim.h"
+#include <math.h>			// sin(), lround()
+#include <sys/eventfd.h>	// eventfd()
+
+// full scale range in volts, indexed by config bits 11:9
+const double darr_sim_fsr[8] = {6.144, 4.096, 2.048, 1.024, 0.512, 0.256, 0.256, 0.256};
+
+// nominal data rates in SPS, indexed by config bits 7:5
+const int iarr_sim_rate_sps[8] = {8, 16, 32, 64, 128, 250, 475, 860};
+
+// (AINP, AINN) per config bits 14:12, -1 is GND
+const int iarr_sim_mux[8][2] = {{0, 1}, {0, 3}, {1, 3}, {2, 3}, {0, -1}, {1, -1}, {2, -1}, {3, -1}};
+
+ads1115_sim_chip *ADS1115_sim_find_chip(ads1115_sim_bus *bus, uint8_t ui8_address) {
+	for (int c = 0; c < ADS1115_SIM_CHIPS; c++) {
+		if (bus->chips[c].ui8_present && bus->chips[c].ui8_address == ui8_address) {
+			return &bus->chips[c];
+			}
+		}
+	return NULL;
+	}
+
+uint64_t ADS1115_sim_get_period_ns(ads1115_sim_chip *chip) {
+	// a fast oscillator (positive error) shortens the conversion
+	double d_nominal_ns = 1e9 / iarr_sim_rate_sps[(chip->ui16_config >> 5) & 0x07];
+	return (uint64_t)(d_nominal_ns / (1.0 + chip->d_rate_error));
+	}
+
+double ADS1115_sim_get_pin(ads1115_sim_chip *chip, int i_ain, double d_time_s) {
+	if (chip->waveform != NULL) {
+		return chip->waveform(i_ain, d_time_s, chip->waveform_context);
+		}
+
+	ads1115_sim_input *input = &chip->inputs[i_ain];
+	double d_phase = input->d_frequency_hz * d_time_s;
+	double d_volts = input->d_offset;
+	switch (input->waveform) {
+		case SIM_SINE:
+			d_volts += input->d_amplitude * sin(2.0 * M_PI * d_phase);
+			break;
+		case SIM_SQUARE:
+			d_volts += (d_phase - floor(d_phase) < 0.5) ? input->d_amplitude : -input->d_amplitude;
+			break;
+		case SIM_RAMP:
+			d_volts += input->d_amplitude * (2.0 * (d_phase - floor(d_phase)) - 1.0);
+			break;
+		default:
+			break;
+			}
+
+	if (input->d_noise > 0) {
+		// xorshift32 -- deterministic per chip, uniform in [-noise, noise)
+		uint32_t x = chip->ui32_noise_state;
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		chip->ui32_noise_state = x;
+		d_volts += input->d_noise * (x / 2147483648.0 - 1.0);
+		}
+	return d_volts;
+	}
+
+int16_t ADS1115_sim_sample(ads1115_sim_bus *bus, ads1115_sim_chip *chip, uint64_t ui64_time_ns) {
+	double d_time_s = (ui64_time_ns - bus->ui64_epoch_ns) / 1e9;
+	const int *mux = iarr_sim_mux[(chip->ui16_config >> 12) & 0x07];
+	double d_volts = ADS1115_sim_get_pin(chip, mux[0], d_time_s);
+	if (mux[1] >= 0) {
+		d_volts -= ADS1115_sim_get_pin(chip, mux[1], d_time_s);
+		}
+
+	long l_code = lround(d_volts * 32768.0 / darr_sim_fsr[(chip->ui16_config >> 9) & 0x07]);
+	if (l_code > 32767) {
+		l_code = 32767;
+		}
+	if (l_code < -32768) {
+		l_code = -32768;
+		}
+	return (int16_t)l_code;
+	}
+
+void ADS1115_sim_signal_alert(ads1115_sim_chip *chip) {
+	// one eventfd count per ALERT/RDY assertion
+	chip->ui8_alert = 1;
+	if (chip->i_alert_fd >= 0) {
+		uint64_t ui64_edge = 1;
+		if (write(chip->i_alert_fd, &ui64_edge, sizeof(ui64_edge)) < 0) {
+			ADS1115_TRACE(ADS1115_TRACE_WARNING, "ADS1115_sim_signal_alert - write: %s", strerror(errno));
+			}
+		}
+	}
+
+int ADS1115_sim_is_ready_mode(ads1115_sim_chip *chip) {
+	// Hi_thresh MSB 1 and Lo_thresh MSB 0 turn ALERT/RDY into a ready signal
+	return (chip->ui16_config & 0x03) != 0x03 && (chip->ui16_high_threshold & 0x8000) && !(chip->ui16_low_threshold & 0x8000);
+	}
+
+void ADS1115_sim_compare(ads1115_sim_chip *chip) {
+	// evaluated once per new conversion, queue bits 11 disable the comparator
+	uint16_t ui16_config = chip->ui16_config;
+	if ((ui16_config & 0x03) == 0x03) {
+		chip->ui8_alert = 0;
+		chip->ui8_queue_count = 0;
+		return;
+		}
+	if (ADS1115_sim_is_ready_mode(chip)) {
+		// asserts at the end of every conversion (a short pulse in continuous mode)
+		ADS1115_sim_signal_alert(chip);
+		if (!(ui16_config & (CONFIG_REGISTER_SINGLE_CONVERSION << 8))) {
+			chip->ui8_alert = 0;
+			}
+		return;
+		}
+	int16_t i16_code = chip->i16_conversion;
+	int16_t i16_low = (int16_t)chip->ui16_low_threshold;
+	int16_t i16_high = (int16_t)chip->ui16_high_threshold;
+	int i_window = ui16_config & CONFIG_REGISTER_COMPARATOR_MODE_WINDOW;
+
+	// traditional asserts above Hi_thresh and releases below Lo_thresh,
+	// window asserts outside the two and releases between them
+	int i_beyond = (i16_code > i16_high) || (i_window && i16_code < i16_low);
+	int i_release = i_window ? !i_beyond : (i16_code < i16_low);
+
+	if (i_beyond) {
+		int i_queue = 1 << (ui16_config & 0x03);
+		if (chip->ui8_queue_count < i_queue) {
+			chip->ui8_queue_count++;
+			}
+		if (chip->ui8_queue_count >= i_queue && !chip->ui8_alert) {
+			ADS1115_sim_signal_alert(chip);
+			}
+		}
+	else {
+		chip->ui8_queue_count = 0;
+		}
+	if (i_release && !(ui16_config & CONFIG_REGISTER_COMPARATOR_LATCHING)) {
+		chip->ui8_alert = 0;
+		}
+	}
+
+void ADS1115_sim_update(ads1115_sim_bus *bus, ads1115_sim_chip *chip, uint64_t ui64_now_ns) {
+	uint64_t ui64_period_ns = ADS1115_sim_get_period_ns(chip);
+
+	if (chip->ui16_config & (CONFIG_REGISTER_SINGLE_CONVERSION << 8)) {
+		// single shot -- latch once the conversion time has passed
+		if (chip->ui8_busy && ui64_now_ns >= chip->ui64_start_ns + ui64_period_ns) {
+			chip->i16_conversion = ADS1115_sim_sample(bus, chip, chip->ui64_start_ns + ui64_period_ns);
+			chip->ui8_busy = 0;
+			ADS1115_sim_compare(chip);
+			}
+		return;
+		}
+
+	// continuous -- latch the most recent completed conversion
+	uint64_t ui64_completed = (ui64_now_ns - chip->ui64_start_ns) / ui64_period_ns;
+	if (ui64_completed > chip->ui64_converted) {
+		chip->i16_conversion = ADS1115_sim_sample(bus, chip, chip->ui64_start_ns + ui64_completed * ui64_period_ns);
+		chip->ui64_converted = ui64_completed;
+		ADS1115_sim_compare(chip);
+		}
+	}
+
+uint64_t ADS1115_sim_get_next_conversion_ns(ads1115_sim_chip *chip) {
+	// when the next result latches, 0 while a single shot chip is powered down
+	uint64_t ui64_period_ns = ADS1115_sim_get_period_ns(chip);
+	if (chip->ui16_config & (CONFIG_REGISTER_SINGLE_CONVERSION << 8)) {
+		return chip->ui8_busy ? chip->ui64_start_ns + ui64_period_ns : 0;
+		}
+	return chip->ui64_start_ns + (chip->ui64_converted + 1) * ui64_period_ns;
+	}
+
+void ADS1115_sim_write(ads1115_sim_chip *chip, const uint8_t *ui8arr_buffer, int i_length, uint64_t ui64_now_ns) {
+	chip->ui8_pointer = ui8arr_buffer[0] & 0x03;
+	if (i_length < 3) {
+		return;
+		}
+
+	uint16_t ui16_value = ui8arr_buffer[1] << 8 | ui8arr_buffer[2];
+	switch (chip->ui8_pointer) {
+		case POINTER_REGISTER_CONFIG:
+			chip->ui16_config = ui16_value & 0x7FFF;
+			if (!(ui16_value & (CONFIG_REGISTER_SINGLE_CONVERSION << 8))) {
+				// any config write in continuous mode restarts the conversion cycle
+				chip->ui8_busy = 0;
+				chip->ui64_start_ns = ui64_now_ns;
+				chip->ui64_converted = 0;
+				}
+			else if ((ui16_value & (CONFIG_REGISTER_START_CONVERSION << 8)) && !chip->ui8_busy) {
+				chip->ui8_busy = 1;
+				chip->ui64_start_ns = ui64_now_ns;
+				if (ADS1115_sim_is_ready_mode(chip)) {
+					// a new conversion releases RDY until it completes
+					chip->ui8_alert = 0;
+					}
+				}
+			break;
+		case POINTER_REGISTER_LOW_THRESHOLD:
+			chip->ui16_low_threshold = ui16_value;
+			break;
+		case POINTER_REGISTER_HIGH_THRESHOLD:
+			chip->ui16_high_threshold = ui16_value;
+			break;
+		default:
+			// conversion register is read only
+			break;
+			}
+	}
+
+void ADS1115_sim_read(ads1115_sim_chip *chip, uint8_t *ui8arr_buffer, int i_length) {
+	uint16_t ui16_value;
+	switch (chip->ui8_pointer) {
+		case POINTER_REGISTER_CONVERSION:
+			ui16_value = (uint16_t)chip->i16_conversion;
+			// reading the result releases a latched ALERT/RDY
+			if (chip->ui16_config & CONFIG_REGISTER_COMPARATOR_LATCHING) {
+				chip->ui8_alert = 0;
+				}
+			break;
+		case POINTER_REGISTER_CONFIG:
+			// OS reads 1 when no conversion is in progress
+			ui16_value = chip->ui16_config | (chip->ui8_busy ? 0 : (CONFIG_REGISTER_IDLE << 8));
+			break;
+		case POINTER_REGISTER_LOW_THRESHOLD:
+			ui16_value = chip->ui16_low_threshold;
+			break;
+		default:
+			ui16_value = chip->ui16_high_threshold;
+			break;
+			}
+	for (int c = 0; c < i_length; c++) {
+		ui8arr_buffer[c] = (c % 2 == 0) ? (ui16_value >> 8) : (ui16_value & 0xFF);
+		}
+	}
+
+int ADS1115_sim_transfer(void *context, struct i2c_msg *msgs, int count) {
+	ads1115_sim_bus *bus = context;
+	int i_status = ADS1115_OK;
+
+	// hold the caller for the time the transfer takes on the wire first --
+	// a chip acts on a transaction at its STOP, not at the START
+	uint64_t ui64_bits = 0;
+	for (int c = 0; c < count; c++) {
+		// start or repeated start, address byte and data bytes at 9 clocks each
+		ui64_bits += 1 + 9 * (1 + msgs[c].len);
+		}
+	uint32_t ui32_bus_hz = bus->ui32_bus_hz;
+	if (ui32_bus_hz > 0) {
+		uint64_t ui64_wire_ns = (ui64_bits + 1) * 1000000000ULL / ui32_bus_hz;
+		struct timespec ts_wait = {ui64_wire_ns / 1000000000ULL, ui64_wire_ns % 1000000000ULL};
+		nanosleep(&ts_wait, NULL);
+		}
+
+	pthread_mutex_lock(&bus->lock);
+	uint64_t ui64_now_ns = ADS1115_get_timestamp_ns();
+	for (int c = 0; c < count; c++) {
+		ads1115_sim_chip *chip = ADS1115_sim_find_chip(bus, msgs[c].addr);
+		if (chip == NULL) {
+			// nobody acknowledges the address
+			i_status = ADS1115_ERROR_IO;
+			break;
+			}
+		ADS1115_sim_update(bus, chip, ui64_now_ns);
+		if (msgs[c].flags & I2C_M_RD) {
+			ADS1115_sim_read(chip, msgs[c].buf, msgs[c].len);
+			}
+		else if (msgs[c].len > 0) {
+			ADS1115_sim_write(chip, msgs[c].buf, msgs[c].len, ui64_now_ns);
+			}
+		bus->ui64_bytes += 1 + msgs[c].len;
+		}
+	bus->ui64_transfers++;
+	bus->ui64_messages += count;
+	// a write may have started a conversion the alert thread has to follow
+	pthread_cond_signal(&bus->alert_wake);
+	pthread_mutex_unlock(&bus->lock);
+	return i_status;
+	}
+
+ads1115_sim_bus *ADS1115_sim_create(uint32_t ui32_bus_hz) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_sim_create");
+	ads1115_sim_bus *bus = calloc(1, sizeof(ads1115_sim_bus));
+	if (bus == NULL) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_sim_create - calloc: %s", strerror(errno));
+		return NULL;
+		}
+	pthread_mutex_init(&bus->lock, NULL);
+	pthread_condattr_t attr;
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&bus->alert_wake, &attr);
+	pthread_condattr_destroy(&attr);
+	bus->ui64_epoch_ns = ADS1115_get_timestamp_ns();
+	bus->ui32_bus_hz = ui32_bus_hz;
+	return bus;
+	}
+
+void ADS1115_sim_destroy(ads1115_sim_bus *bus) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_sim_destroy");
+	pthread_mutex_lock(&bus->lock);
+	uint8_t ui8_running = bus->ui8_alert_running;
+	bus->ui8_alert_running = 0;
+	pthread_cond_signal(&bus->alert_wake);
+	pthread_mutex_unlock(&bus->lock);
+	if (ui8_running) {
+		pthread_join(bus->alert_thread, NULL);
+		}
+	for (int c = 0; c < ADS1115_SIM_CHIPS; c++) {
+		if (bus->chips[c].ui8_present && bus->chips[c].i_alert_fd >= 0) {
+			close(bus->chips[c].i_alert_fd);
+			}
+		}
+	pthread_cond_destroy(&bus->alert_wake);
+	pthread_mutex_destroy(&bus->lock);
+	free(bus);
+	}
+
+int ADS1115_sim_add_chip(ads1115_sim_bus *bus, enum ADS1115_ADDRESS addr) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_sim_add_chip");
+	pthread_mutex_lock(&bus->lock);
+	int i_status = ADS1115_ERROR_INVALID;
+	if (ADS1115_sim_find_chip(bus, addr) == NULL) {
+		for (int c = 0; c < ADS1115_SIM_CHIPS; c++) {
+			ads1115_sim_chip *chip = &bus->chips[c];
+			if (!chip->ui8_present) {
+				memset(chip, 0, sizeof(ads1115_sim_chip));
+				chip->ui8_present = 1;
+				chip->ui8_address = addr;
+				chip->ui16_config = ADS1115_SIM_POWER_ON_CONFIG & 0x7FFF;
+				chip->ui16_low_threshold = 0x8000;
+				chip->ui16_high_threshold = 0x7FFF;
+				chip->ui32_noise_state = 0x9E3779B9u ^ addr;
+				chip->i_alert_fd = -1;
+				i_status = ADS1115_OK;
+				break;
+				}
+			}
+		}
+	pthread_mutex_unlock(&bus->lock);
+	if (i_status != ADS1115_OK) {
+		ADS1115_TRACE(ADS1115_TRACE_WARNING, "ADS1115_sim_add_chip - address in use or bus full");
+		}
+	return i_status;
+	}
+
+int ADS1115_sim_set_input(ads1115_sim_bus *bus, enum ADS1115_ADDRESS addr, int i_ain, enum ADS1115_SIM_WAVEFORM waveform,
+	double d_offset, double d_amplitude, double d_frequency_hz, double d_noise) {
+	if (i_ain < 0 || i_ain >= ADS1115_SIM_INPUTS) {
+		return ADS1115_ERROR_INVALID;
+		}
+	pthread_mutex_lock(&bus->lock);
+	ads1115_sim_chip *chip = ADS1115_sim_find_chip(bus, addr);
+	if (chip != NULL) {
+		ads1115_sim_input input = {waveform, d_offset, d_amplitude, d_frequency_hz, d_noise};
+		chip->inputs[i_ain] = input;
+		}
+	pthread_mutex_unlock(&bus->lock);
+	return (chip != NULL) ? ADS1115_OK : ADS1115_ERROR_INVALID;
+	}
+
+int ADS1115_sim_set_waveform(ads1115_sim_bus *bus, enum ADS1115_ADDRESS addr, ads1115_sim_waveform waveform, void *context) {
+	pthread_mutex_lock(&bus->lock);
+	ads1115_sim_chip *chip = ADS1115_sim_find_chip(bus, addr);
+	if (chip != NULL) {
+		chip->waveform = waveform;
+		chip->waveform_context = context;
+		}
+	pthread_mutex_unlock(&bus->lock);
+	return (chip != NULL) ? ADS1115_OK : ADS1115_ERROR_INVALID;
+	}
+
+int ADS1115_sim_set_rate_error(ads1115_sim_bus *bus, enum ADS1115_ADDRESS addr, double d_rate_error) {
+	pthread_mutex_lock(&bus->lock);
+	ads1115_sim_chip *chip = ADS1115_sim_find_chip(bus, addr);
+	if (chip != NULL) {
+		chip->d_rate_error = d_rate_error;
+		}
+	pthread_mutex_unlock(&bus->lock);
+	return (chip != NULL) ? ADS1115_OK : ADS1115_ERROR_INVALID;
+	}
+
+void *ADS1115_sim_alert_thread(void *arg) {
+	// latch conversions as they complete so the comparator sees every one
+	ads1115_sim_bus *bus = arg;
+	pthread_mutex_lock(&bus->lock);
+	while (bus->ui8_alert_running) {
+		uint64_t ui64_now_ns = ADS1115_get_timestamp_ns();
+		uint64_t ui64_next_ns = 0;
+		for (int c = 0; c < ADS1115_SIM_CHIPS; c++) {
+			ads1115_sim_chip *chip = &bus->chips[c];
+			if (!chip->ui8_present || chip->i_alert_fd < 0) {
+				continue;
+				}
+			ADS1115_sim_update(bus, chip, ui64_now_ns);
+			uint64_t ui64_due_ns = ADS1115_sim_get_next_conversion_ns(chip);
+			if (ui64_due_ns != 0 && (ui64_next_ns == 0 || ui64_due_ns < ui64_next_ns)) {
+				ui64_next_ns = ui64_due_ns;
+				}
+			}
+		if (ui64_next_ns == 0) {
+			// every chip is powered down, sleep until a transfer starts one
+			pthread_cond_wait(&bus->alert_wake, &bus->lock);
+			}
+		else {
+			struct timespec ts_due = {ui64_next_ns / 1000000000ULL, ui64_next_ns % 1000000000ULL};
+			pthread_cond_timedwait(&bus->alert_wake, &bus->lock, &ts_due);
+			}
+		}
+	pthread_mutex_unlock(&bus->lock);
+	return NULL;
+	}
+
+int ADS1115_sim_get_alert_fd(ads1115_sim_bus *bus, enum ADS1115_ADDRESS addr) {
+	ADS1115_TRACE(ADS1115_TRACE_INFO, "ADS1115_sim_get_alert_fd");
+	// the fd belongs to the bus and is closed by ADS1115_sim_destroy()
+	pthread_mutex_lock(&bus->lock);
+	ads1115_sim_chip *chip = ADS1115_sim_find_chip(bus, addr);
+	int i_fd = -1;
+	if (chip != NULL) {
+		if (chip->i_alert_fd < 0) {
+			chip->i_alert_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+			}
+		i_fd = chip->i_alert_fd;
+		}
+	if (i_fd >= 0 && !bus->ui8_alert_running) {
+		bus->ui8_alert_running = 1;
+		int i_result = pthread_create(&bus->alert_thread, NULL, ADS1115_sim_alert_thread, bus);
+		if (i_result != 0) {
+			ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_sim_get_alert_fd - pthread_create: %s", strerror(i_result));
+			bus->ui8_alert_running = 0;
+			}
+		}
+	pthread_mutex_unlock(&bus->lock);
+	if (i_fd < 0) {
+		ADS1115_TRACE(ADS1115_TRACE_ERROR, "ADS1115_sim_get_alert_fd - no chip or eventfd: %s", strerror(errno));
+		}
+	return i_fd;
+	}
+
+void ADS1115_sim_get_transport(ads1115_sim_bus *bus, ads1115_transport *transport) {
+	// the bus is owned by the caller, closing a device leaves it alone
+	transport->transfer = ADS1115_sim_transfer;
+	transport->close = NULL;
+	transport->context = bus;
+	}
+
+ads1115_dev *ADS1115_sim_init(ads1115_sim_bus *bus, int id, enum ADS1115_ADDRESS addr) {
+	ads1115_transport transport;
+	ADS1115_sim_get_transport(bus, &transport);
+	return ADS1115_init_transport(&transport, id, addr);
+	}
@@ -0,0 +1,118 @@
+/* File:		ads1115_sim.h
+ * Purpose: 	in-process ADS1115 simulator, a transport backend for ads1115.c
+ *
+ * Preface:		ads1115_sim.h - models up to four ADS1115 chips on one
+ * 				simulated I2C bus: the pointer, config, conversion and
+ * 				threshold registers, the OS busy bit, single shot and
+ * 				continuous conversions timed from the RATE_MASK (with an
+ * 				optional oscillator error), and the input multiplexer and
+ * 				PGA applied to configurable waveforms on AIN0..AIN3.
+ * 				Conversions run against CLOCK_MONOTONIC, so code under test
+ * 				sees real conversion latencies. An optional bus speed adds
+ * 				the wire time of every transfer; the chips act on a
+ * 				transfer once that time has passed, at its STOP.
+ *
+ * 				The comparator follows the threshold registers and the
+ * 				comparator bits of the config register. ADS1115_sim_get_alert_fd()
+ * 				hands out an eventfd that becomes readable each time
+ * 				ALERT/RDY asserts; from then on a bus thread keeps
+ * 				converting while nobody talks to the chip.
+ *
+ * 				Devices are opened with ADS1115_sim_init(), which hands
+ * 				ADS1115_init_transport() a transport bound to the bus. The
+ * 				bus must outlive every device opened on it.
+ * */
+#ifndef ADS1115_SIM_H
+#define ADS1115_SIM_H
+
+#include "ads1115.h"
+#include <pthread.h>		// pthread_mutex_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+//DEFINE****************************************************************
+#define ADS1115_SIM_CHIPS			4
+#define ADS1115_SIM_INPUTS			4
+#define ADS1115_SIM_POWER_ON_CONFIG	0x8583
+
+enum ADS1115_SIM_WAVEFORM {
+	SIM_CONSTANT,
+	SIM_SINE,
+	SIM_SQUARE,
+	SIM_RAMP
+	};
+
+// user supplied input, returns the voltage on AIN i_ain at d_time_s
+typedef double (*ads1115_sim_waveform)(int i_ain, double d_time_s, void *context);
+
+typedef struct ads1115_sim_input {
+	enum ADS1115_SIM_WAVEFORM waveform;
+	double d_offset;
+	double d_amplitude;
+	double d_frequency_hz;
+	double d_noise;
+	} ads1115_sim_input;
+
+typedef struct ads1115_sim_chip {
+	uint8_t ui8_address;
+	uint8_t ui8_present;
+
+	// registers
+	uint8_t ui8_pointer;
+	uint16_t ui16_config;
+	uint16_t ui16_low_threshold;
+	uint16_t ui16_high_threshold;
+	int16_t i16_conversion;
+
+	// conversion timing
+	uint8_t ui8_busy;
+	uint64_t ui64_start_ns;
+	uint64_t ui64_converted;
+	double d_rate_error;
+
+	// comparator and ALERT/RDY
+	uint8_t ui8_alert;
+	uint8_t ui8_queue_count;
+	int i_alert_fd;
+
+	// analog front end
+	ads1115_sim_input inputs[ADS1115_SIM_INPUTS];
+	ads1115_sim_waveform waveform;
+	void *waveform_context;
+	uint32_t ui32_noise_state;
+	} ads1115_sim_chip;
+
+typedef struct ads1115_sim_bus {
+	pthread_mutex_t lock;
+	ads1115_sim_chip chips[ADS1115_SIM_CHIPS];
+	uint64_t ui64_epoch_ns;
+	uint32_t ui32_bus_hz;
+
+	// advances chips with an alert fd between transfers
+	pthread_t alert_thread;
+	pthread_cond_t alert_wake;
+	uint8_t ui8_alert_running;
+
+	// traffic seen by the bus
+	uint64_t ui64_transfers;
+	uint64_t ui64_messages;
+	uint64_t ui64_bytes;
+	} ads1115_sim_bus;
+//**********************************************************************
+//PROTOTYPE*************************************************************
+ads1115_sim_bus *ADS1115_sim_create(uint32_t ui32_bus_hz);
+void ADS1115_sim_destroy(ads1115_sim_bus *bus);
+int ADS1115_sim_add_chip(ads1115_sim_bus *bus, enum ADS1115_ADDRESS addr);
+int ADS1115_sim_set_input(ads1115_sim_bus *bus, enum ADS1115_ADDRESS addr, int i_ain, enum ADS1115_SIM_WAVEFORM waveform,
+	double d_offset, double d_amplitude, double d_frequency_hz, double d_noise);
+int ADS1115_sim_set_waveform(ads1115_sim_bus *bus, enum ADS1115_ADDRESS addr, ads1115_sim_waveform waveform, void *context);
+int ADS1115_sim_set_rate_error(ads1115_sim_bus *bus, enum ADS1115_ADDRESS addr, double d_rate_error);
+int ADS1115_sim_get_alert_fd(ads1115_sim_bus *bus, enum ADS1115_ADDRESS addr);
+void ADS1115_sim_get_transport(ads1115_sim_bus *bus, ads1115_transport *transport);
+ads1115_dev *ADS1115_sim_init(ads1115_sim_bus *bus, int id, enum ADS1115_ADDRESS addr);
+//**********************************************************************
+#ifdef __cplusplus
+}
+#endif
+#endif
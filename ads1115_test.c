@@ -0,0 +1,1215 @@
+/* File:		ads1115_test.c
+ * Purpose: 	regression tests for ads1115.c against the simulator
+ *
+ * Preface:		one test function per feature, run against the chip
+ * 				model from ads1115_sim.h, so the wire protocol, the
+ * 				conversion timing and the alert path are checked
+ * 				without hardware. Prints one line per check and exits
+ * 				nonzero if any check failed.
+ *
+ * Usage:		ads1115_test
+ */
+
+#include "ads1115.h"
+#include "ads1115_sim.h"
+#include "ads1115_filter.h"
+#include "ads1115_capture.h"
+#include "ads1115_acq.h"
+#include "ads1115_async.h"
+#include "ads1115_shm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <unistd.h>
+
+#define TEST_BUS_HZ				400000
+#define TEST_STREAM_SAMPLES		64
+#define TEST_CAPTURE_SAMPLES	1000
+#define TEST_CAPTURE_BLOCK		100
+#define TEST_GROUP_SAMPLES		4096
+#define TEST_GROUP_RUN_MS		300
+#define TEST_SHM_CAPACITY		64
+#define TEST_DRIFT_RATE_ERROR	0.05
+#define TEST_DRIFT_ROUNDS		8
+#define TEST_DRIFT_TOLERANCE	0.02
+#define TEST_ADAPTIVE_SAMPLES	16
+#define TEST_TIMEOUT_MS			10
+#define TEST_RATE_LOG			64
+
+int i_test_failures = 0;
+
+void test_check(int i_passed, const char *cp_name) {
+	printf("%s %s\n", i_passed ? "ok  " : "FAIL", cp_name);
+	if (!i_passed) {
+		i_test_failures++;
+		}
+	}
+
+const double darr_inputs[4] = {0.25, 1.0, 2.5, 3.75};
+const enum MULT_MASK earr_channels[4] = {MULT_AIN_0, MULT_AIN_1, MULT_AIN_2, MULT_AIN_3};
+
+ads1115_dev *test_open_constant(ads1115_sim_bus *bus, enum ADS1115_ADDRESS addr, const char *cp_name) {
+	// a chip with darr_inputs on its four inputs
+	ADS1115_sim_add_chip(bus, addr);
+	for (int c = 0; c < 4; c++) {
+		ADS1115_sim_set_input(bus, addr, c, SIM_CONSTANT, darr_inputs[c], 0, 0, 0);
+		}
+	ads1115_dev *dev = ADS1115_sim_init(bus, 0, addr);
+	test_check(dev != NULL, cp_name);
+	return dev;
+	}
+
+void test_single_shot(void) {
+	// one constant per input, each conversion within a couple of LSB and no faster than the datasheet allows
+	ads1115_sim_bus *bus = ADS1115_sim_create(TEST_BUS_HZ);
+	ads1115_dev *dev = test_open_constant(bus, GND, "single shot: open");
+	if (dev == NULL) {
+		ADS1115_sim_destroy(bus);
+		return;
+		}
+	ADS1115_set_conversion_mode(dev, SINGLE);
+	ADS1115_set_pga(dev, PGA_4_096);
+	ADS1115_set_conversion_rate(dev, SPS_128);
+
+	double d_lsb = 4.096 / 32768.0;
+	int i_accurate = 1;
+	int i_waited = 1;
+	for (int c = 0; c < 4; c++) {
+		ADS1115_set_multiplex(dev, earr_channels[c]);
+		double d_volts = 0;
+		uint64_t ui64_start = ADS1115_get_timestamp_ns();
+		if (ADS1115_get_single_conversion(dev, &d_volts) != ADS1115_OK) {
+			i_accurate = 0;
+			continue;
+			}
+		if (ADS1115_get_timestamp_ns() - ui64_start < (uint64_t)ADS1115_get_conversion_period_ns(dev)) {
+			i_waited = 0;
+			}
+		if (fabs(d_volts - darr_inputs[c]) > 2 * d_lsb) {
+			i_accurate = 0;
+			}
+		}
+	test_check(i_accurate, "single shot: every input converts to its voltage");
+	test_check(i_waited, "single shot: no result before the conversion period");
+
+	// a 125 ms conversion against a 10 ms timeout gives up at the deadline, not after the conversion
+	ADS1115_set_conversion_rate(dev, SPS_8);
+	ADS1115_set_timeout(dev, TEST_TIMEOUT_MS);
+	double d_volts;
+	uint64_t ui64_start = ADS1115_get_timestamp_ns();
+	int i_status = ADS1115_get_single_conversion(dev, &d_volts);
+	uint64_t ui64_waited = ADS1115_get_timestamp_ns() - ui64_start;
+	test_check(i_status == ADS1115_ERROR_TIMEOUT && ui64_waited < (uint64_t)ADS1115_get_conversion_period_ns(dev) / 2, "single shot: timeout bounds the wait");
+
+	ADS1115_close(dev);
+	ADS1115_sim_destroy(bus);
+	}
+
+void test_scan_sweep(void) {
+	// each entry converts its own channel at its own gain, and the setters survive the sweep
+	const enum PGA_MASK earr_pgas[4] = {PGA_0_512, PGA_2_048, PGA_4_096, PGA_6_144};
+	const double darr_ranges[4] = {PGA_0_512V, PGA_2_048V, PGA_4_096V, PGA_6_144V};
+	ads1115_sim_bus *bus = ADS1115_sim_create(TEST_BUS_HZ);
+	ads1115_dev *dev = test_open_constant(bus, GND, "scan sweep: open");
+	if (dev == NULL) {
+		ADS1115_sim_destroy(bus);
+		return;
+		}
+	ADS1115_set_conversion_mode(dev, SINGLE);
+	ADS1115_set_multiplex(dev, MULT_AIN_1);
+	ADS1115_set_pga(dev, PGA_1_024);
+	for (int c = 0; c < 4; c++) {
+		ADS1115_scan_add(dev, earr_channels[3 - c], earr_pgas[c], SPS_475);
+		}
+
+	double darr_results[4] = {0};
+	int i_count = ADS1115_scan_sweep(dev, darr_results);
+	test_check(i_count == 4, "scan sweep: every entry converted");
+	int i_accurate = 1;
+	for (int c = 0; c < i_count; c++) {
+		// an input past the entry's range reads full scale
+		double d_expected = fmin(darr_inputs[3 - c], darr_ranges[c]);
+		if (fabs(darr_results[c] - d_expected) > 2 * darr_ranges[c] / 32768.0) {
+			i_accurate = 0;
+			}
+		}
+	test_check(i_accurate, "scan sweep: entries in order at their own gain");
+
+	// a second sweep reuses the list, single reads still follow the setters
+	i_count = ADS1115_scan_sweep(dev, darr_results);
+	test_check(i_count == 4 && fabs(darr_results[3] - darr_inputs[0]) < 2 * PGA_6_144V / 32768.0, "scan sweep: repeats");
+	ADS1115_scan_clear(dev);
+	double d_volts = 0;
+	int i_status = ADS1115_get_single_conversion(dev, &d_volts);
+	test_check(i_status == ADS1115_OK && fabs(d_volts - darr_inputs[1]) < 2 * PGA_1_024V / 32768.0, "scan sweep: setters left alone");
+
+	ADS1115_close(dev);
+	ADS1115_sim_destroy(bus);
+	}
+
+int test_outputs_match(const double *darr_output, int i_outputs, const double *darr_expected, int i_expected) {
+	if (i_outputs != i_expected) {
+		return 0;
+		}
+	for (int c = 0; c < i_expected; c++) {
+		if (fabs(darr_output[c] - darr_expected[c]) > 1e-9) {
+			return 0;
+			}
+		}
+	return 1;
+	}
+
+void test_filter(void) {
+	// each filter against outputs worked out by hand
+	const int16_t i16arr_ramp[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+	double darr_output[8];
+	int i_outputs;
+
+	ads1115_filter *filter = ADS1115_filter_create(FILTER_MOVING_AVERAGE, 4, 1);
+	i_outputs = ADS1115_filter_process(filter, i16arr_ramp, 8, darr_output);
+	const double darr_average[5] = {2.5, 3.5, 4.5, 5.5, 6.5};
+	test_check(test_outputs_match(darr_output, i_outputs, darr_average, 5), "filter: moving average waits for its window");
+	ADS1115_filter_destroy(filter);
+
+	const int16_t i16arr_step[3] = {0, 8, 8};
+	filter = ADS1115_filter_create(FILTER_EMA, 3, 1);
+	i_outputs = ADS1115_filter_process(filter, i16arr_step, 3, darr_output);
+	const double darr_ema[3] = {0, 4, 6};
+	test_check(test_outputs_match(darr_output, i_outputs, darr_ema, 3), "filter: exponential smoothing");
+	ADS1115_filter_destroy(filter);
+
+	filter = ADS1115_filter_create(FILTER_BOXCAR, 1, 4);
+	i_outputs = ADS1115_filter_process(filter, i16arr_ramp, 8, darr_output);
+	const double darr_boxcar[2] = {2.5, 6.5};
+	test_check(test_outputs_match(darr_output, i_outputs, darr_boxcar, 2), "filter: boxcar decimates");
+	ADS1115_filter_destroy(filter);
+
+	const int16_t i16arr_spikes[5] = {5, 100, 7, 6, -50};
+	filter = ADS1115_filter_create(FILTER_MEDIAN, 3, 1);
+	i_outputs = ADS1115_filter_process(filter, i16arr_spikes, 5, darr_output);
+	const double darr_median[3] = {7, 7, 6};
+	test_check(test_outputs_match(darr_output, i_outputs, darr_median, 3), "filter: median drops spikes");
+	ADS1115_filter_destroy(filter);
+
+	// unity gain, a constant comes out unchanged once the combs have filled
+	int16_t i16arr_constant[16];
+	for (int c = 0; c < 16; c++) {
+		i16arr_constant[c] = -1000;
+		}
+	filter = ADS1115_filter_create(FILTER_CIC, 1, 2);
+	i_outputs = ADS1115_filter_process(filter, i16arr_constant, 16, darr_output);
+	const double darr_cic[6] = {-1000, -1000, -1000, -1000, -1000, -1000};
+	test_check(test_outputs_match(darr_output, i_outputs, darr_cic, 8 - ADS1115_FILTER_CIC_ORDER + 1), "filter: CIC settles to the input");
+	ADS1115_filter_destroy(filter);
+
+	test_check(ADS1115_filter_create(FILTER_BOXCAR, 1, 0) == NULL, "filter: zero decimation rejected");
+
+	// off the simulator, in volts
+	ads1115_sim_bus *bus = ADS1115_sim_create(TEST_BUS_HZ);
+	ads1115_dev *dev = test_open_constant(bus, GND, "filter: open");
+	if (dev == NULL) {
+		ADS1115_sim_destroy(bus);
+		return;
+		}
+	ADS1115_set_conversion_mode(dev, CONTINUOUS);
+	ADS1115_set_multiplex(dev, MULT_AIN_2);
+	ADS1115_set_pga(dev, PGA_4_096);
+	ADS1115_set_conversion_rate(dev, SPS_860);
+	filter = ADS1115_filter_create(FILTER_BOXCAR, 1, 4);
+	double darr_volts[3] = {0};
+	i_outputs = ADS1115_filter_read_stream(dev, filter, darr_volts, 3);
+	int i_accurate = (i_outputs == 3);
+	for (int c = 0; c < i_outputs; c++) {
+		if (fabs(darr_volts[c] - darr_inputs[2]) > 2 * PGA_4_096V / 32768.0) {
+			i_accurate = 0;
+			}
+		}
+	test_check(i_accurate, "filter: stream from the device in volts");
+	ADS1115_filter_destroy(filter);
+
+	double d_average = 0;
+	test_check(ADS1115_get_average_conversions(dev, 0, &d_average) == ADS1115_ERROR_INVALID, "filter: empty average rejected");
+	test_check(ADS1115_get_average_conversions(dev, 8, &d_average) == ADS1115_OK && fabs(d_average - darr_inputs[2]) < 2 * PGA_4_096V / 32768.0, "filter: average of conversions");
+
+	ADS1115_close(dev);
+	ADS1115_sim_destroy(bus);
+	}
+
+void test_autorange(void) {
+	// a clipped code is converted again, a value between the marks keeps whatever range it has
+	ads1115_sim_bus *bus = ADS1115_sim_create(TEST_BUS_HZ);
+	ads1115_dev *dev = test_open_constant(bus, GND, "autorange: open");
+	if (dev == NULL) {
+		ADS1115_sim_destroy(bus);
+		return;
+		}
+	ADS1115_set_conversion_mode(dev, SINGLE);
+	ADS1115_set_conversion_rate(dev, SPS_860);
+	ADS1115_set_pga(dev, PGA_2_048);
+	ADS1115_set_autorange(dev, 1);
+
+	// 2.5 V clips at 2.048 V, the answer comes from the 6.144 V retry
+	ads1115_stats stats;
+	ADS1115_get_stats(dev, &stats);
+	uint64_t ui64_retries = stats.ui64_retries;
+	double d_volts = 0;
+	ADS1115_set_multiplex(dev, MULT_AIN_2);
+	int i_status = ADS1115_get_single_conversion(dev, &d_volts);
+	ADS1115_get_stats(dev, &stats);
+	test_check(i_status == ADS1115_OK && fabs(d_volts - darr_inputs[2]) < 2 * PGA_6_144V / 32768.0, "autorange: clipped code converted again");
+	test_check(stats.ui64_retries == ui64_retries + 1, "autorange: clipped code counted as a retry");
+	test_check(dev->ui8_config_register_pga_mask == PGA_4_096, "autorange: narrows to the range that fits");
+
+	// 1.0 V fits well under 2.048 V, the switch costs no conversion
+	ADS1115_set_multiplex(dev, MULT_AIN_1);
+	ADS1115_get_single_conversion(dev, &d_volts);
+	ADS1115_get_stats(dev, &stats);
+	test_check(dev->ui8_config_register_pga_mask == PGA_2_048 && stats.ui64_retries == ui64_retries + 1, "autorange: in range code kept");
+	ADS1115_get_single_conversion(dev, &d_volts);
+	test_check(fabs(d_volts - darr_inputs[1]) < 2 * PGA_2_048V / 32768.0, "autorange: narrow range reads the value");
+
+	// 1.75 V is over 70 % of 2.048 V and under 95 %, neither range gives way to the other
+	ADS1115_sim_set_input(bus, GND, 0, SIM_CONSTANT, 1.75, 0, 0, 0);
+	ADS1115_set_multiplex(dev, MULT_AIN_0);
+	const enum PGA_MASK earr_ranges[2] = {PGA_2_048, PGA_4_096};
+	int i_held = 1;
+	for (int r = 0; r < 2; r++) {
+		ADS1115_set_pga(dev, earr_ranges[r]);
+		for (int c = 0; c < 4; c++) {
+			if (ADS1115_get_single_conversion(dev, &d_volts) != ADS1115_OK || dev->ui8_config_register_pga_mask != earr_ranges[r]) {
+				i_held = 0;
+				}
+			}
+		}
+	test_check(i_held, "autorange: hysteresis holds either range");
+
+	ADS1115_close(dev);
+	ADS1115_sim_destroy(bus);
+	}
+
+void test_adaptive(void) {
+	// a quiet input steps the rate down one step per ADS1115_ADAPTIVE_QUIET_SAMPLES
+	// quiet codes, a fast slope jumps straight to the fastest rate
+	ads1115_sim_bus *bus = ADS1115_sim_create(TEST_BUS_HZ);
+	ads1115_dev *dev = test_open_constant(bus, GND, "adaptive: open");
+	if (dev == NULL) {
+		ADS1115_sim_destroy(bus);
+		return;
+		}
+	ADS1115_set_conversion_mode(dev, SINGLE);
+	ADS1115_set_multiplex(dev, MULT_AIN_1);
+	ADS1115_set_pga(dev, PGA_4_096);
+	ADS1115_set_conversion_rate(dev, SPS_128);
+	test_check(ADS1115_set_adaptive_thresholds(dev, SPS_475, SPS_64, 4, 64) == ADS1115_ERROR_INVALID &&
+		ADS1115_set_adaptive_thresholds(dev, SPS_64, SPS_475, 4, 7) == ADS1115_ERROR_INVALID, "adaptive: inverted limits and close thresholds refused");
+	test_check(ADS1115_set_adaptive_thresholds(dev, SPS_64, SPS_475, 4, 64) == ADS1115_OK, "adaptive: thresholds set");
+	ADS1115_set_adaptive_rate(dev, 1);
+
+	// the first code only sets the reference, the step comes with the last quiet one
+	ads1115_sample samples[TEST_ADAPTIVE_SAMPLES];
+	ADS1115_read_samples(dev, samples, ADS1115_ADAPTIVE_QUIET_SAMPLES);
+	test_check(dev->ui8_config_register_conversion_rate_mask == SPS_128, "adaptive: rate held until enough quiet codes");
+	ADS1115_read_samples(dev, samples, 1);
+	test_check(dev->ui8_config_register_conversion_rate_mask == SPS_64, "adaptive: quiet input steps the rate down");
+	ADS1115_read_samples(dev, samples, ADS1115_ADAPTIVE_QUIET_SAMPLES);
+	test_check(dev->ui8_config_register_conversion_rate_mask == SPS_64, "adaptive: never below the slowest rate");
+
+	// 1 V/s moves well over the busy threshold per conversion at 64 SPS and
+	// between the thresholds at 475 SPS, so the rate rises and then stays
+	ADS1115_sim_set_input(bus, GND, 1, SIM_RAMP, 2.0, 1.0, 0.5, 0);
+	ADS1115_read_samples(dev, samples, 1);
+	test_check(dev->ui8_config_register_conversion_rate_mask == SPS_475, "adaptive: busy input jumps to the fastest rate");
+	int i_held = 1;
+	for (int c = 0; c < TEST_ADAPTIVE_SAMPLES; c++) {
+		ADS1115_read_samples(dev, samples, 1);
+		if (dev->ui8_config_register_conversion_rate_mask != SPS_475) {
+			i_held = 0;
+			}
+		}
+	test_check(i_held, "adaptive: moving input holds the fastest rate");
+
+	ADS1115_close(dev);
+	ADS1115_sim_destroy(bus);
+	}
+
+typedef struct test_rate_log {
+	ads1115_transport inner;
+	uint8_t ui8arr_rates[TEST_RATE_LOG];
+	int i_count;
+	} test_rate_log;
+
+int test_rate_log_transfer(void *context, struct i2c_msg *msgs, int count) {
+	// the simulator's transport, noting the rate of every conversion started
+	test_rate_log *log = context;
+	for (int c = 0; c < count; c++) {
+		if (!(msgs[c].flags & I2C_M_RD) && msgs[c].len == 3 && msgs[c].buf[0] == POINTER_REGISTER_CONFIG &&
+			(msgs[c].buf[1] & CONFIG_REGISTER_START_CONVERSION) && log->i_count < TEST_RATE_LOG) {
+			log->ui8arr_rates[log->i_count++] = msgs[c].buf[2] & 0b11100000;
+			}
+		}
+	return log->inner.transfer(log->inner.context, msgs, count);
+	}
+
+void test_adaptive_scan(void) {
+	// a scan entry's rate changes after the conversion that decided it, each
+	// sample still carries the rate the chip was started with
+	ads1115_sim_bus *bus = ADS1115_sim_create(TEST_BUS_HZ);
+	ADS1115_sim_add_chip(bus, GND);
+	ADS1115_sim_set_input(bus, GND, 1, SIM_CONSTANT, darr_inputs[1], 0, 0, 0);
+	static test_rate_log log;
+	memset(&log, 0, sizeof(log));
+	ADS1115_sim_get_transport(bus, &log.inner);
+	ads1115_transport transport = {test_rate_log_transfer, NULL, &log};
+	ads1115_dev *dev = ADS1115_init_transport(&transport, 0, GND);
+	test_check(dev != NULL, "adaptive scan: open");
+	if (dev == NULL) {
+		ADS1115_sim_destroy(bus);
+		return;
+		}
+	ADS1115_set_adaptive_thresholds(dev, SPS_64, SPS_475, 4, 64);
+	ADS1115_set_adaptive_rate(dev, 1);
+	ADS1115_scan_add(dev, MULT_AIN_1, PGA_4_096, SPS_250);
+	ADS1115_scan_add(dev, MULT_AIN_1, PGA_4_096, SPS_128);
+
+	// enough quiet sweeps for both entries to step down at least once
+	ads1115_sample samples[2];
+	int i_tagged = 1;
+	int i_stepped = 0;
+	for (int c = 0; c < 2 * (ADS1115_ADAPTIVE_QUIET_SAMPLES + 1); c++) {
+		int i_first = log.i_count;
+		if (ADS1115_scan_sweep_samples(dev, samples) != 2 || log.i_count != i_first + 2) {
+			i_tagged = 0;
+			break;
+			}
+		for (int e = 0; e < 2; e++) {
+			if (samples[e].ui8_rate_mask != log.ui8arr_rates[i_first + e]) {
+				i_tagged = 0;
+				}
+			if (dev->scan_list[e].ui8_rate_mask != samples[e].ui8_rate_mask) {
+				i_stepped = 1;
+				}
+			}
+		}
+	test_check(i_stepped, "adaptive scan: quiet entries step down");
+	test_check(i_tagged, "adaptive scan: samples tagged with the rate converted at");
+
+	ADS1115_close(dev);
+	ADS1115_sim_destroy(bus);
+	}
+
+int test_continuous_stream(ads1115_dev *dev, double d_codes_per_period, int *ip_repeats, int *ip_fractional, long *lp_uncounted) {
+	// one stream of the ramp, returns the codes read. A late read counts the
+	// conversions it passes over at once, but those its own transfer ran past
+	// the ramp shows one step later -- at the first and the last read of the
+	// stream the two may differ by what that read counted, and by no more.
+	int16_t i16arr_codes[TEST_STREAM_SAMPLES];
+	const int iarr_parts[3] = {1, TEST_STREAM_SAMPLES - 2, 1};
+	uint64_t ui64arr_skipped[4];
+	ads1115_stats stats;
+	int i_read = 0;
+	ADS1115_get_stats(dev, &stats);
+	ui64arr_skipped[0] = stats.ui64_skipped;
+	for (int p = 0; p < 3; p++) {
+		int i_part = ADS1115_read_stream_raw(dev, &i16arr_codes[i_read], iarr_parts[p]);
+		if (i_part != iarr_parts[p]) {
+			return i_read + ((i_part > 0) ? i_part : 0);
+			}
+		i_read += i_part;
+		ADS1115_get_stats(dev, &stats);
+		ui64arr_skipped[p + 1] = stats.ui64_skipped;
+		}
+
+	// a late read may pass over conversions, but only whole ones, and it counts them
+	long l_periods = 0;
+	for (int c = 1; c < i_read; c++) {
+		int i_step = i16arr_codes[c] - i16arr_codes[c - 1];
+		int i_periods = (int)(i_step / d_codes_per_period + 0.5);
+		if (i_step == 0) {
+			(*ip_repeats)++;
+			}
+		if (i_periods < 1 || fabs(i_step - i_periods * d_codes_per_period) > 2) {
+			(*ip_fractional)++;
+			}
+		l_periods += i_periods;
+		}
+	long l_counted = (long)(ui64arr_skipped[2] - ui64arr_skipped[0]);
+	long l_first = (long)(ui64arr_skipped[1] - ui64arr_skipped[0]);
+	long l_last = (long)(ui64arr_skipped[3] - ui64arr_skipped[2]);
+	long l_uncounted = l_periods - (i_read - 1) - l_counted;
+	*lp_uncounted = (l_uncounted > l_last) ? l_uncounted - l_last : ((l_uncounted < -l_first) ? l_uncounted + l_first : 0);
+	return i_read;
+	}
+
+void test_continuous(void) {
+	// a ramp changes every conversion, so a repeated code means a sample was read
+	// twice -- on a chip as slow or as fast as TEST_DRIFT_RATE_ERROR, before its
+	// clock is known and once it is
+	const double darr_errors[3] = {-TEST_DRIFT_RATE_ERROR, 0, TEST_DRIFT_RATE_ERROR};
+	int i_complete = 1;
+	int iarr_repeats[2] = {0, 0};
+	int i_fractional = 0;
+	long l_uncounted = 0;
+	for (int c = 0; c < 6; c++) {
+		int e = c / 2;
+		int i_learned = c % 2;
+		ads1115_sim_bus *bus = ADS1115_sim_create(TEST_BUS_HZ);
+		ADS1115_sim_add_chip(bus, GND);
+		ADS1115_sim_set_input(bus, GND, 0, SIM_RAMP, 0, 4.0, 0.25, 0);
+		ADS1115_sim_set_rate_error(bus, GND, darr_errors[e]);
+		ads1115_dev *dev = ADS1115_sim_init(bus, 0, GND);
+		test_check(dev != NULL, "continuous: open");
+		if (dev == NULL) {
+			ADS1115_sim_destroy(bus);
+			i_complete = 0;
+			continue;
+			}
+		ADS1115_set_conversion_mode(dev, CONTINUOUS);
+		ADS1115_set_multiplex(dev, MULT_AIN_0);
+		ADS1115_set_pga(dev, PGA_4_096);
+		ADS1115_set_conversion_rate(dev, SPS_250);
+		if (i_learned) {
+			// the clock as RDY edges or single shot pairs teach it, see test_drift()
+			dev->darr_clock_ratio[SPS_250 >> 5] = 1 / (1 + darr_errors[e]);
+			}
+
+		// 2 V/s against 4.096 V full scale is 64 codes per nominal period at 250 SPS
+		long l_stream_uncounted;
+		i_complete &= (test_continuous_stream(dev, 64 / (1 + darr_errors[e]), &iarr_repeats[i_learned], &i_fractional, &l_stream_uncounted) == TEST_STREAM_SAMPLES);
+		if (i_learned) {
+			l_uncounted += labs(l_stream_uncounted);
+			}
+
+		ADS1115_close(dev);
+		ADS1115_sim_destroy(bus);
+		}
+	test_check(i_complete, "continuous: full stream read");
+	test_check(iarr_repeats[0] == 0, "continuous: no sample read twice before the clock is learned");
+	test_check(iarr_repeats[1] == 0, "continuous: no sample read twice at the learned clock");
+	test_check(i_fractional == 0, "continuous: ramp steps are whole periods");
+	test_check(l_uncounted == 0, "continuous: skipped conversions counted");
+	}
+
+void test_comparator(void) {
+	// one chip above Hi_thresh must raise ALERT, one between the thresholds must stay quiet
+	ads1115_sim_bus *bus = ADS1115_sim_create(TEST_BUS_HZ);
+	ADS1115_sim_add_chip(bus, GND);
+	ADS1115_sim_add_chip(bus, VDD);
+	ADS1115_sim_set_input(bus, GND, 0, SIM_CONSTANT, 3.0, 0, 0, 0);
+	ADS1115_sim_set_input(bus, VDD, 0, SIM_CONSTANT, 1.5, 0, 0, 0);
+
+	const enum ADS1115_ADDRESS earr_addresses[2] = {GND, VDD};
+	const int iarr_expected[2] = {ADS1115_OK, ADS1115_ERROR_TIMEOUT};
+	const char *cparr_names[2] = {"comparator: alert above the high threshold", "comparator: no alert inside the thresholds"};
+	for (int d = 0; d < 2; d++) {
+		ads1115_dev *dev = ADS1115_sim_init(bus, 0, earr_addresses[d]);
+		if (dev == NULL) {
+			test_check(0, cparr_names[d]);
+			continue;
+			}
+		ADS1115_set_conversion_mode(dev, CONTINUOUS);
+		ADS1115_set_multiplex(dev, MULT_AIN_0);
+		ADS1115_set_pga(dev, PGA_4_096);
+		ADS1115_set_conversion_rate(dev, SPS_860);
+		ADS1115_set_comparator_mode(dev, TRADITIONAL);
+		ADS1115_set_comparator_queue(dev, QUEUE_LENGTH_1);
+		ADS1115_set_alert_fd(dev, ADS1115_sim_get_alert_fd(bus, earr_addresses[d]));
+
+		int16_t i16_code;
+		int i_status = ADS1115_set_thresholds(dev, 1.0, 2.0);
+		if (i_status == ADS1115_OK) {
+			// the first read writes the config register and starts the conversions
+			i_status = (ADS1115_read_stream_raw(dev, &i16_code, 1) == 1) ? ADS1115_OK : ADS1115_ERROR_IO;
+			}
+		if (i_status == ADS1115_OK) {
+			i_status = ADS1115_wait_alert(dev, 100, &i16_code);
+			}
+		test_check(i_status == iarr_expected[d], cparr_names[d]);
+		ADS1115_close(dev);
+		}
+	ADS1115_sim_destroy(bus);
+	}
+
+void test_threshold_volts(void) {
+	// thresholds set in volts keep their value across PGA changes, from auto-range and from the setter
+	ads1115_sim_bus *bus = ADS1115_sim_create(TEST_BUS_HZ);
+	ADS1115_sim_add_chip(bus, GND);
+	ADS1115_sim_set_input(bus, GND, 0, SIM_CONSTANT, 2.5, 0, 0, 0);
+	ads1115_dev *dev = ADS1115_sim_init(bus, 0, GND);
+	test_check(dev != NULL, "threshold volts: open");
+	if (dev == NULL) {
+		ADS1115_sim_destroy(bus);
+		return;
+		}
+	ADS1115_set_conversion_mode(dev, CONTINUOUS);
+	ADS1115_set_multiplex(dev, MULT_AIN_0);
+	ADS1115_set_pga(dev, PGA_0_256);
+	ADS1115_set_conversion_rate(dev, SPS_860);
+	ADS1115_set_comparator_mode(dev, TRADITIONAL);
+	ADS1115_set_comparator_queue(dev, QUEUE_LENGTH_1);
+	ADS1115_set_alert_fd(dev, ADS1115_sim_get_alert_fd(bus, GND));
+
+	// both clamp to full scale at 0.256 V, the input could never cross them there
+	ADS1115_set_thresholds(dev, 1.0, 2.0);
+	ADS1115_set_autorange(dev, 1);
+	ads1115_sample samples[4];
+	int i_read = ADS1115_read_samples(dev, samples, 4);
+	double d_lsb = dev->f_resolution;
+	int i_following = (i_read == 4 && dev->ui8_config_register_pga_mask != PGA_0_256);
+	i_following &= (dev->ui16arr_register_shadow[POINTER_REGISTER_LOW_THRESHOLD] == (uint16_t)(int16_t)lround(1.0 / d_lsb));
+	i_following &= (dev->ui16arr_register_shadow[POINTER_REGISTER_HIGH_THRESHOLD] == (uint16_t)(int16_t)lround(2.0 / d_lsb));
+	test_check(i_following, "threshold volts: rewritten when auto-range moves the PGA");
+	int16_t i16_code;
+	test_check(ADS1115_wait_alert(dev, 100, &i16_code) == ADS1115_OK, "threshold volts: alarm at the new range");
+
+	ADS1115_set_autorange(dev, 0);
+	ADS1115_set_pga(dev, PGA_6_144);
+	i_read = ADS1115_read_stream_raw(dev, &i16_code, 1);
+	d_lsb = dev->f_resolution;
+	i_following = (i_read == 1);
+	i_following &= (dev->ui16arr_register_shadow[POINTER_REGISTER_LOW_THRESHOLD] == (uint16_t)(int16_t)lround(1.0 / d_lsb));
+	i_following &= (dev->ui16arr_register_shadow[POINTER_REGISTER_HIGH_THRESHOLD] == (uint16_t)(int16_t)lround(2.0 / d_lsb));
+	test_check(i_following, "threshold volts: rewritten when the PGA is set");
+
+	ADS1115_close(dev);
+	ADS1115_sim_destroy(bus);
+	}
+
+void test_ready_mode(void) {
+	// with ALERT/RDY wired up, every result comes from the edge and not from config register polls
+	ads1115_sim_bus *bus = ADS1115_sim_create(TEST_BUS_HZ);
+	ads1115_dev *dev = test_open_constant(bus, GND, "ready mode: open");
+	if (dev == NULL) {
+		ADS1115_sim_destroy(bus);
+		return;
+		}
+	ADS1115_set_conversion_mode(dev, SINGLE);
+	ADS1115_set_pga(dev, PGA_4_096);
+	ADS1115_set_conversion_rate(dev, SPS_475);
+	ADS1115_set_comparator_queue(dev, QUEUE_LENGTH_2);
+	ADS1115_set_thresholds(dev, 1.0, 2.0);
+	int16_t i16_low = dev->i16_threshold_low;
+	int16_t i16_high = dev->i16_threshold_high;
+	ADS1115_set_alert_fd(dev, ADS1115_sim_get_alert_fd(bus, GND));
+	test_check(ADS1115_set_ready_mode(dev, 1) == ADS1115_OK, "ready mode: enabled");
+
+	ads1115_stats stats;
+	ADS1115_get_stats(dev, &stats);
+	uint64_t ui64_polls = stats.ui64_polls;
+	int i_accurate = 1;
+	for (int c = 0; c < 4; c++) {
+		ADS1115_set_multiplex(dev, earr_channels[c]);
+		double d_volts = 0;
+		if (ADS1115_get_single_conversion(dev, &d_volts) != ADS1115_OK || fabs(d_volts - darr_inputs[c]) > 2 * PGA_4_096V / 32768.0) {
+			i_accurate = 0;
+			}
+		}
+	ADS1115_get_stats(dev, &stats);
+	test_check(i_accurate, "ready mode: single shots read on the edge");
+	test_check(stats.ui64_polls == ui64_polls, "ready mode: single shots never poll");
+
+	// a ramp changes every conversion, each edge must bring a new code
+	ADS1115_sim_set_input(bus, GND, 0, SIM_RAMP, 0, 1.0, 1.0, 0);
+	ADS1115_set_multiplex(dev, MULT_AIN_0);
+	ADS1115_set_conversion_mode(dev, CONTINUOUS);
+	int16_t i16arr_codes[TEST_STREAM_SAMPLES];
+	int i_read = ADS1115_read_stream_raw(dev, i16arr_codes, TEST_STREAM_SAMPLES);
+	int i_repeats = 0;
+	for (int c = 1; c < i_read; c++) {
+		if (i16arr_codes[c] == i16arr_codes[c - 1]) {
+			i_repeats++;
+			}
+		}
+	ADS1115_get_stats(dev, &stats);
+	test_check(i_read == TEST_STREAM_SAMPLES && i_repeats == 0, "ready mode: stream takes one code per edge");
+	test_check(stats.ui64_polls == ui64_polls, "ready mode: stream never polls");
+
+	// without the pin the same reads poll again
+	ADS1115_set_alert_fd(dev, -1);
+	ADS1115_set_conversion_mode(dev, SINGLE);
+	double d_volts = 0;
+	ADS1115_get_single_conversion(dev, &d_volts);
+	ADS1115_get_stats(dev, &stats);
+	test_check(stats.ui64_polls > ui64_polls, "ready mode: falls back to polling without an alert fd");
+
+	// off again, the alarm set before ready mode fires as it did -- a ramp
+	// through both thresholds raises it once per period
+	int i_restored = (ADS1115_set_ready_mode(dev, 0) == ADS1115_OK);
+	i_restored &= (dev->ui8_config_register_comparator_queue_mask == QUEUE_LENGTH_2);
+	i_restored &= (dev->ui16arr_register_shadow[POINTER_REGISTER_LOW_THRESHOLD] == (uint16_t)i16_low);
+	i_restored &= (dev->ui16arr_register_shadow[POINTER_REGISTER_HIGH_THRESHOLD] == (uint16_t)i16_high);
+	test_check(i_restored, "ready mode: queue and thresholds given back");
+	ADS1115_sim_set_input(bus, GND, 0, SIM_RAMP, 1.5, 1.5, 20.0, 0);
+	ADS1115_set_alert_fd(dev, ADS1115_sim_get_alert_fd(bus, GND));
+	ADS1115_set_conversion_mode(dev, CONTINUOUS);
+	int16_t i16_code;
+	int i_status = (ADS1115_read_stream_raw(dev, &i16_code, 1) == 1) ? ADS1115_OK : ADS1115_ERROR_IO;
+	if (i_status == ADS1115_OK) {
+		// edges left over from ready mode
+		ADS1115_wait_alert(dev, 0, &i16_code);
+		i_status = ADS1115_wait_alert(dev, 200, &i16_code);
+		}
+	test_check(i_status == ADS1115_OK, "ready mode: threshold alarm fires after it");
+
+	ADS1115_close(dev);
+	ADS1115_sim_destroy(bus);
+	}
+
+void test_capture_samples(ads1115_sample *samples, int count) {
+	// three devices interleaved at a jittery rate, one of them dropping a sample now and then
+	uint64_t ui64_time_ns = 1000000000ULL;
+	uint32_t ui32arr_sequence[3] = {0, 100, 7};
+	for (int c = 0; c < count; c++) {
+		int d = c % 3;
+		ads1115_sample *sample = &samples[c];
+		memset(sample, 0, sizeof(ads1115_sample));
+		ui64_time_ns += 1162790 + (c * 7919) % 20000;
+		sample->ui64_timestamp_ns = ui64_time_ns;
+		sample->ui32_sequence = ui32arr_sequence[d]++;
+		if (d == 2 && c % 50 == 2) {
+			ui32arr_sequence[d] += 3;
+			}
+		sample->i16_code = (int16_t)(8000 * sin(c / 30.0) + d * 1000);
+		sample->ui8_mult_mask = earr_channels[(c / 200) % 4];
+		sample->ui8_pga_mask = (c < 500) ? PGA_4_096 : PGA_0_512;
+		sample->ui8_rate_mask = SPS_860;
+		sample->ui8_bus_id = (uint8_t)(d / 2);
+		sample->ui8_address = (d == 1) ? VDD : GND;
+		}
+	}
+
+int test_samples_equal(const ads1115_sample *a, const ads1115_sample *b) {
+	return a->ui64_timestamp_ns == b->ui64_timestamp_ns && a->ui32_sequence == b->ui32_sequence &&
+		a->i16_code == b->i16_code && a->ui8_mult_mask == b->ui8_mult_mask &&
+		a->ui8_pga_mask == b->ui8_pga_mask && a->ui8_rate_mask == b->ui8_rate_mask &&
+		a->ui8_bus_id == b->ui8_bus_id && a->ui8_address == b->ui8_address;
+	}
+
+int test_capture_matches(ads1115_capture_reader *reader, const ads1115_sample *samples, int count) {
+	// the rest of the file from the cursor on is exactly samples[0..count)
+	ads1115_sample read[TEST_CAPTURE_BLOCK];
+	int i_checked = 0;
+	for (;;) {
+		int i_read = ADS1115_capture_read(reader, read, TEST_CAPTURE_BLOCK);
+		if (i_read <= 0) {
+			return i_read == 0 && i_checked == count;
+			}
+		for (int c = 0; c < i_read; c++) {
+			if (i_checked >= count || !test_samples_equal(&read[c], &samples[i_checked++])) {
+				return 0;
+				}
+			}
+		}
+	}
+
+void test_capture(void) {
+	// every field survives the round trip, seek lands on the first sample at or after the time
+	static ads1115_sample samples[TEST_CAPTURE_SAMPLES];
+	test_capture_samples(samples, TEST_CAPTURE_SAMPLES);
+	char carr_path[64];
+	snprintf(carr_path, sizeof(carr_path), "/tmp/ads1115_test_%d.cap", (int)getpid());
+
+	const enum ADS1115_CAPTURE_FLAGS earr_flags[2] = {ADS1115_CAPTURE_RAW, ADS1115_CAPTURE_DELTA};
+	const char *cparr_names[2] = {"capture: raw codes round trip", "capture: delta codes round trip"};
+	for (int f = 0; f < 2; f++) {
+		ads1115_capture_writer *writer = ADS1115_capture_create(carr_path, earr_flags[f], TEST_CAPTURE_BLOCK);
+		int i_written = writer != NULL &&
+			ADS1115_capture_append(writer, samples, TEST_CAPTURE_SAMPLES) == ADS1115_OK &&
+			ADS1115_capture_close(writer) == ADS1115_OK;
+		ads1115_capture_reader *reader = i_written ? ADS1115_capture_open(carr_path) : NULL;
+		test_check(reader != NULL && reader->ui64_samples == TEST_CAPTURE_SAMPLES && test_capture_matches(reader, samples, TEST_CAPTURE_SAMPLES), cparr_names[f]);
+		if (reader == NULL) {
+			continue;
+			}
+
+		// on a sample, between two samples, before the first and after the last
+		int i_seeks = 1;
+		const int iarr_targets[3] = {537, 99, 0};
+		for (int c = 0; c < 3; c++) {
+			int t = iarr_targets[c];
+			i_seeks &= ADS1115_capture_seek(reader, samples[t].ui64_timestamp_ns) == ADS1115_OK &&
+				test_capture_matches(reader, &samples[t], TEST_CAPTURE_SAMPLES - t);
+			i_seeks &= ADS1115_capture_seek(reader, samples[t].ui64_timestamp_ns - 1) == ADS1115_OK &&
+				test_capture_matches(reader, &samples[t], TEST_CAPTURE_SAMPLES - t);
+			}
+		ads1115_sample sample;
+		i_seeks &= ADS1115_capture_seek(reader, samples[TEST_CAPTURE_SAMPLES - 1].ui64_timestamp_ns + 1) == ADS1115_OK &&
+			ADS1115_capture_read(reader, &sample, 1) == 0;
+		test_check(i_seeks, (f == 0) ? "capture: raw seek by time" : "capture: delta seek by time");
+		ADS1115_capture_release(reader);
+		}
+
+	// a writer that never closed leaves no index, the flushed blocks still read
+	ads1115_capture_writer *writer = ADS1115_capture_create(carr_path, ADS1115_CAPTURE_DELTA, TEST_CAPTURE_BLOCK);
+	if (writer != NULL) {
+		ADS1115_capture_append(writer, samples, 2 * TEST_CAPTURE_BLOCK + TEST_CAPTURE_BLOCK / 2);
+		}
+	ads1115_capture_reader *reader = (writer != NULL) ? ADS1115_capture_open(carr_path) : NULL;
+	test_check(reader != NULL && reader->ui32_blocks == 2 && test_capture_matches(reader, samples, 2 * TEST_CAPTURE_BLOCK), "capture: unclosed file reads its flushed blocks");
+	if (reader != NULL) {
+		test_check(ADS1115_capture_seek(reader, samples[150].ui64_timestamp_ns) == ADS1115_OK &&
+			test_capture_matches(reader, &samples[150], 2 * TEST_CAPTURE_BLOCK - 150), "capture: unclosed file seeks");
+		ADS1115_capture_release(reader);
+		}
+	if (writer != NULL) {
+		ADS1115_capture_close(writer);
+		}
+
+	// a trailer whose index offset wraps past the end of the file, 1 block at (uint64_t)-16
+	FILE *file = fopen(carr_path, "r+b");
+	uint8_t ui8arr_corrupt[2 * ADS1115_CAPTURE_HEADER_SIZE];
+	int i_corrupted = file != NULL && fread(ui8arr_corrupt, 1, ADS1115_CAPTURE_HEADER_SIZE, file) == ADS1115_CAPTURE_HEADER_SIZE;
+	if (file != NULL) {
+		fclose(file);
+		}
+	uint8_t *ui8arr_trailer = &ui8arr_corrupt[ADS1115_CAPTURE_HEADER_SIZE];
+	const uint64_t ui64_wrapped = (uint64_t)0 - ADS1115_CAPTURE_TRAILER_SIZE;
+	for (int c = 0; c < 8; c++) {
+		ui8arr_trailer[c] = (uint8_t)(ui64_wrapped >> (8 * c));
+		}
+	const uint32_t ui32arr_words[2] = {1, ADS1115_CAPTURE_INDEX_MAGIC};
+	for (int c = 0; c < 8; c++) {
+		ui8arr_trailer[8 + c] = (uint8_t)(ui32arr_words[c / 4] >> (8 * (c % 4)));
+		}
+	file = i_corrupted ? fopen(carr_path, "wb") : NULL;
+	i_corrupted = file != NULL && fwrite(ui8arr_corrupt, 1, sizeof(ui8arr_corrupt), file) == sizeof(ui8arr_corrupt);
+	if (file != NULL) {
+		fclose(file);
+		}
+	reader = i_corrupted ? ADS1115_capture_open(carr_path) : NULL;
+	test_check(i_corrupted && (reader == NULL || reader->ui32_blocks == 0), "capture: corrupt trailer ignored");
+	if (reader != NULL) {
+		ADS1115_capture_release(reader);
+		}
+	remove(carr_path);
+	}
+
+void test_sleep_ms(int i_ms) {
+	poll(NULL, 0, i_ms);
+	}
+
+void test_group(void) {
+	// two buses, three devices at three rates: one stream in stamp order, no device losing a sample
+	ads1115_sim_bus *buses[2] = {ADS1115_sim_create(TEST_BUS_HZ), ADS1115_sim_create(TEST_BUS_HZ)};
+	const int iarr_bus[3] = {0, 0, 1};
+	const enum ADS1115_ADDRESS earr_addresses[3] = {GND, VDD, GND};
+	const enum CONVERSION_MODE_MASK earr_modes[3] = {CONTINUOUS, CONTINUOUS, SINGLE};
+	const enum RATE_MASK earr_rates[3] = {SPS_250, SPS_475, SPS_860};
+	ads1115_dev *devs[3] = {NULL};
+	int i_opened = 1;
+	for (int d = 0; d < 3; d++) {
+		ads1115_sim_bus *bus = buses[iarr_bus[d]];
+		ADS1115_sim_add_chip(bus, earr_addresses[d]);
+		ADS1115_sim_set_input(bus, earr_addresses[d], 0, SIM_RAMP, 0, 1.0, 1.0, 0);
+		devs[d] = ADS1115_sim_init(bus, iarr_bus[d], earr_addresses[d]);
+		if (devs[d] == NULL) {
+			i_opened = 0;
+			continue;
+			}
+		ADS1115_set_conversion_mode(devs[d], earr_modes[d]);
+		ADS1115_set_multiplex(devs[d], MULT_AIN_0);
+		ADS1115_set_pga(devs[d], PGA_4_096);
+		ADS1115_set_conversion_rate(devs[d], earr_rates[d]);
+		}
+	ads1115_acq_group *group = i_opened ? ADS1115_acq_group_create(devs, 3, TEST_GROUP_SAMPLES) : NULL;
+	test_check(group != NULL && ADS1115_acq_group_start(group, NULL, 0) == ADS1115_OK, "group: started");
+	if (group != NULL) {
+		static ads1115_sample samples[TEST_GROUP_SAMPLES];
+		int i_total = 0;
+		uint64_t ui64_end_ns = ADS1115_get_timestamp_ns() + TEST_GROUP_RUN_MS * 1000000ULL;
+		while (ADS1115_get_timestamp_ns() < ui64_end_ns) {
+			test_sleep_ms(10);
+			i_total += ADS1115_acq_group_drain(group, &samples[i_total], TEST_GROUP_SAMPLES - i_total);
+			}
+		ADS1115_acq_group_stop(group);
+		i_total += ADS1115_acq_group_drain(group, &samples[i_total], TEST_GROUP_SAMPLES - i_total);
+
+		int i_ordered = 1;
+		for (int c = 1; c < i_total; c++) {
+			if (samples[c].ui64_timestamp_ns < samples[c - 1].ui64_timestamp_ns) {
+				i_ordered = 0;
+				}
+			}
+		int i_consecutive = 1;
+		int iarr_seen[3] = {0};
+		for (int d = 0; d < 3; d++) {
+			uint32_t ui32_next = 0;
+			for (int c = 0; c < i_total; c++) {
+				if (samples[c].ui8_bus_id != iarr_bus[d] || samples[c].ui8_address != earr_addresses[d]) {
+					continue;
+					}
+				if (iarr_seen[d]++ > 0 && samples[c].ui32_sequence != ui32_next) {
+					i_consecutive = 0;
+					}
+				ui32_next = samples[c].ui32_sequence + 1;
+				}
+			}
+		test_check(iarr_seen[0] > 0 && iarr_seen[1] > 0 && iarr_seen[2] > 0, "group: every device delivers");
+		test_check(i_ordered, "group: merged stream in stamp order");
+		test_check(i_consecutive && ADS1115_acq_group_get_overruns(group) == 0, "group: sequence numbers without gaps");
+		test_check(ADS1115_acq_group_get_errors(group) == 0, "group: no read errors");
+		ADS1115_acq_group_destroy(group);
+		}
+	for (int d = 0; d < 3; d++) {
+		if (devs[d] != NULL) {
+			ADS1115_close(devs[d]);
+			}
+		}
+	ADS1115_sim_destroy(buses[0]);
+	ADS1115_sim_destroy(buses[1]);
+	}
+
+void test_async_callback(const ads1115_async_result *result, void *context) {
+	// context is the result slot of the test, status still pending until called
+	*(ads1115_async_result *)context = *result;
+	}
+
+void test_async(void) {
+	// requests on two chips overlap, a queued or converting request can be cancelled and never shows up
+	ads1115_sim_bus *bus = ADS1115_sim_create(TEST_BUS_HZ);
+	ads1115_dev *devs[2] = {test_open_constant(bus, GND, "async: open"), test_open_constant(bus, VDD, "async: open second")};
+	ads1115_async *async = ADS1115_async_create();
+	test_check(async != NULL, "async: create");
+	if (devs[0] == NULL || devs[1] == NULL || async == NULL) {
+		for (int d = 0; d < 2; d++) {
+			if (devs[d] != NULL) {
+				ADS1115_close(devs[d]);
+				}
+			}
+		if (async != NULL) {
+			ADS1115_async_destroy(async);
+			}
+		ADS1115_sim_destroy(bus);
+		return;
+		}
+	const int iarr_inputs[2] = {2, 1};
+	for (int d = 0; d < 2; d++) {
+		ADS1115_set_conversion_mode(devs[d], SINGLE);
+		ADS1115_set_multiplex(devs[d], earr_channels[iarr_inputs[d]]);
+		ADS1115_set_pga(devs[d], PGA_4_096);
+		ADS1115_set_conversion_rate(devs[d], SPS_16);
+		}
+
+	// the first device: one cancelled while converting, one kept, one cancelled in the queue
+	uint32_t ui32_converting, ui32_kept, ui32_queued, ui32_second, ui32_callback;
+	ads1115_async_result callback_result = {0, ADS1115_PENDING, {0}};
+	uint64_t ui64_start = ADS1115_get_timestamp_ns();
+	int i_started = ADS1115_async_start(async, devs[0], NULL, NULL, &ui32_converting) == ADS1115_OK &&
+		ADS1115_async_start(async, devs[1], NULL, NULL, &ui32_second) == ADS1115_OK &&
+		ADS1115_async_start(async, devs[1], test_async_callback, &callback_result, &ui32_callback) == ADS1115_OK &&
+		ADS1115_async_cancel(async, ui32_converting) == ADS1115_OK &&
+		ADS1115_async_start(async, devs[0], NULL, NULL, &ui32_kept) == ADS1115_OK &&
+		ADS1115_async_start(async, devs[0], NULL, NULL, &ui32_queued) == ADS1115_OK &&
+		ADS1115_async_cancel(async, ui32_queued) == ADS1115_OK;
+	test_check(i_started, "async: start and cancel");
+	test_check(ADS1115_async_cancel(async, ui32_converting) == ADS1115_ERROR_INVALID, "async: second cancel rejected");
+
+	// an event loop on the two fds until everything is in or a second has gone by
+	struct pollfd pollfds[2] = {{ADS1115_async_get_timer_fd(async), POLLIN, 0}, {ADS1115_async_get_event_fd(async), POLLIN, 0}};
+	ads1115_async_result results[ADS1115_ASYNC_REQUESTS];
+	int i_collected = 0;
+	while (i_started && (i_collected < 2 || callback_result.i_status == ADS1115_PENDING) &&
+		ADS1115_get_timestamp_ns() - ui64_start < 1000000000ULL) {
+		if (poll(pollfds, 2, 100) <= 0) {
+			continue;
+			}
+		if (pollfds[0].revents & POLLIN) {
+			ADS1115_async_process(async);
+			}
+		if (pollfds[1].revents & POLLIN) {
+			i_collected += ADS1115_async_collect(async, &results[i_collected], ADS1115_ASYNC_REQUESTS - i_collected);
+			}
+		}
+	double d_seconds = (ADS1115_get_timestamp_ns() - ui64_start) / 1e9;
+
+	int i_expected = (i_collected == 2);
+	for (int c = 0; c < i_collected; c++) {
+		int d = (results[c].ui32_token == ui32_kept) ? 0 : 1;
+		if ((results[c].ui32_token != ui32_kept && results[c].ui32_token != ui32_second) || results[c].i_status != ADS1115_OK ||
+			fabs(ADS1115_sample_to_volts(&results[c].sample) - darr_inputs[iarr_inputs[d]]) > 2 * PGA_4_096V / 32768.0) {
+			i_expected = 0;
+			}
+		}
+	test_check(i_expected, "async: collected results, none of the cancelled ones");
+	test_check(callback_result.ui32_token == ui32_callback && callback_result.i_status == ADS1115_OK &&
+		fabs(ADS1115_sample_to_volts(&callback_result.sample) - darr_inputs[iarr_inputs[1]]) < 2 * PGA_4_096V / 32768.0, "async: callback result");
+
+	// each chip runs two conversions of 62.5 ms back to back, side by side with the other
+	test_check(d_seconds < 3.5 / 16, "async: chips convert side by side");
+
+	// a request queued behind another keeps the first one's result tagged with its own setup
+	uint32_t ui32arr_setup[2];
+	const enum PGA_MASK earr_pgas[2] = {PGA_4_096, PGA_6_144};
+	i_started = 1;
+	for (int c = 0; c < 2; c++) {
+		ADS1115_set_multiplex(devs[1], earr_channels[c]);
+		ADS1115_set_pga(devs[1], earr_pgas[c]);
+		i_started &= (ADS1115_async_start(async, devs[1], NULL, NULL, &ui32arr_setup[c]) == ADS1115_OK);
+		}
+	ui64_start = ADS1115_get_timestamp_ns();
+	i_collected = 0;
+	while (i_started && i_collected < 2 && ADS1115_get_timestamp_ns() - ui64_start < 1000000000ULL) {
+		if (poll(pollfds, 2, 100) <= 0) {
+			continue;
+			}
+		if (pollfds[0].revents & POLLIN) {
+			ADS1115_async_process(async);
+			}
+		if (pollfds[1].revents & POLLIN) {
+			i_collected += ADS1115_async_collect(async, &results[i_collected], ADS1115_ASYNC_REQUESTS - i_collected);
+			}
+		}
+	i_expected = (i_collected == 2);
+	for (int c = 0; c < i_collected; c++) {
+		int i = (results[c].ui32_token == ui32arr_setup[0]) ? 0 : 1;
+		if (results[c].i_status != ADS1115_OK || results[c].sample.ui8_mult_mask != earr_channels[i] ||
+			results[c].sample.ui8_pga_mask != earr_pgas[i] ||
+			fabs(ADS1115_sample_to_volts(&results[c].sample) - darr_inputs[i]) > 2 * PGA_6_144V / 32768.0) {
+			i_expected = 0;
+			}
+		}
+	test_check(i_expected, "async: results tagged with the setup they converted with");
+
+	// the first look at a conversion longer than the timeout comes at the deadline
+	ADS1115_set_conversion_rate(devs[0], SPS_8);
+	ADS1115_set_timeout(devs[0], TEST_TIMEOUT_MS);
+	uint32_t ui32_timeout;
+	test_check(ADS1115_async_start(async, devs[0], NULL, NULL, &ui32_timeout) == ADS1115_OK &&
+		ADS1115_async_get_timeout_ms(async) <= TEST_TIMEOUT_MS, "async: timeout bounds the first look");
+
+	ADS1115_async_destroy(async);
+	ADS1115_close(devs[0]);
+	ADS1115_close(devs[1]);
+	ADS1115_sim_destroy(bus);
+	}
+
+void test_staggered(void) {
+	// four chips on one bus convert side by side, one of them clipping and converting again
+	ads1115_sim_bus *bus = ADS1115_sim_create(TEST_BUS_HZ);
+	const enum ADS1115_ADDRESS earr_addresses[4] = {GND, VDD, SDA, SCL};
+	ads1115_dev *devs[4] = {NULL};
+	int i_opened = 1;
+	for (int d = 0; d < 4; d++) {
+		devs[d] = test_open_constant(bus, earr_addresses[d], "staggered: open");
+		if (devs[d] == NULL) {
+			i_opened = 0;
+			continue;
+			}
+		ADS1115_set_conversion_mode(devs[d], SINGLE);
+		ADS1115_set_multiplex(devs[d], earr_channels[d]);
+		ADS1115_set_pga(devs[d], PGA_4_096);
+		ADS1115_set_conversion_rate(devs[d], SPS_32);
+		}
+	if (i_opened) {
+		// 2.5 V clips at 0.256 V
+		ADS1115_set_pga(devs[2], PGA_0_256);
+		ADS1115_set_autorange(devs[2], 1);
+
+		ads1115_sample samples[4];
+		uint64_t ui64_start = ADS1115_get_timestamp_ns();
+		int i_read = ADS1115_read_samples_staggered(devs, 4, samples);
+		double d_seconds = (ADS1115_get_timestamp_ns() - ui64_start) / 1e9;
+		test_check(i_read == 4, "staggered: one sample per chip");
+
+		int i_accurate = (i_read == 4);
+		int i_ordered = 1;
+		for (int c = 0; c < i_read; c++) {
+			int d = 0;
+			while (d < 3 && samples[c].ui8_address != earr_addresses[d]) {
+				d++;
+				}
+			if (samples[c].ui8_address != earr_addresses[d] || fabs(ADS1115_sample_to_volts(&samples[c]) - darr_inputs[d]) > 2 * PGA_6_144V / 32768.0) {
+				i_accurate = 0;
+				}
+			if (c > 0 && samples[c].ui64_timestamp_ns < samples[c - 1].ui64_timestamp_ns) {
+				i_ordered = 0;
+				}
+			}
+		test_check(i_accurate, "staggered: every chip converts its input");
+		test_check(i_ordered, "staggered: samples in completion order");
+		test_check(i_read == 4 && samples[3].ui8_address == SDA && samples[3].ui8_pga_mask == PGA_6_144, "staggered: clipped chip converts again at the widest range");
+
+		// serial conversion would take five periods of 31.25 ms, side by side takes two
+		test_check(d_seconds < 4.0 / 32, "staggered: chips convert side by side");
+		}
+	for (int d = 0; d < 4; d++) {
+		if (devs[d] != NULL) {
+			ADS1115_close(devs[d]);
+			}
+		}
+	ADS1115_sim_destroy(bus);
+	}
+
+void test_drift(void) {
+	// a chip whose oscillator runs 5 % fast, learned from single shots at a slow
+	// and a fast rate timed to the RDY edge
+	ads1115_sim_bus *bus = ADS1115_sim_create(TEST_BUS_HZ);
+	ads1115_dev *dev = test_open_constant(bus, GND, "drift: open");
+	if (dev == NULL) {
+		ADS1115_sim_destroy(bus);
+		return;
+		}
+	ADS1115_sim_set_rate_error(bus, GND, TEST_DRIFT_RATE_ERROR);
+	ADS1115_set_conversion_mode(dev, SINGLE);
+	ADS1115_set_pga(dev, PGA_4_096);
+	ADS1115_set_alert_fd(dev, ADS1115_sim_get_alert_fd(bus, GND));
+	ADS1115_set_ready_mode(dev, 1);
+	test_check(ADS1115_get_clock_ratio(dev) == 1.0, "drift: nominal clock before a conversion");
+
+	const enum RATE_MASK earr_rates[2] = {SPS_8, SPS_64};
+	for (int c = 0; c < 2 * TEST_DRIFT_ROUNDS; c++) {
+		ADS1115_set_conversion_rate(dev, earr_rates[c % 2]);
+		double d_volts;
+		ADS1115_get_single_conversion(dev, &d_volts);
+		}
+	double d_expected = 1 / (1 + TEST_DRIFT_RATE_ERROR);
+	double d_ratio = ADS1115_get_clock_ratio(dev);
+	test_check(fabs(d_ratio - d_expected) < TEST_DRIFT_TOLERANCE, "drift: clock ratio follows the simulated rate error");
+	long l_expected_ns = (long)(ADS1115_get_conversion_period_ns(dev) * d_expected);
+	test_check(labs(ADS1115_get_sample_period_ns(dev) - l_expected_ns) < l_expected_ns * TEST_DRIFT_TOLERANCE, "drift: sample period at the learned clock");
+
+	ADS1115_close(dev);
+	ADS1115_sim_destroy(bus);
+	}
+
+void test_stats(void) {
+	// percentiles from a histogram filled by hand, then the counters of real conversions
+	ads1115_stats stats;
+	memset(&stats, 0, sizeof(stats));
+	test_check(ADS1115_stats_latency_percentile_ns(&stats, 50) == 0, "stats: no percentile before a conversion");
+	stats.ui64arr_latency[3] = 90;
+	stats.ui64arr_latency[10] = 9;
+	stats.ui64arr_latency[ADS1115_LATENCY_BUCKETS - 1] = 1;
+	stats.ui64_conversions = 100;
+	stats.ui64_latency_max_ns = 5000000000ULL;
+	test_check(ADS1115_stats_latency_percentile_ns(&stats, 50) == 16000 &&
+		ADS1115_stats_latency_percentile_ns(&stats, 90) == 16000 &&
+		ADS1115_stats_latency_percentile_ns(&stats, 95) == 2048000 &&
+		ADS1115_stats_latency_percentile_ns(&stats, 100) == 5000000000ULL, "stats: percentiles from the histogram");
+
+	ads1115_sim_bus *bus = ADS1115_sim_create(TEST_BUS_HZ);
+	ads1115_dev *dev = test_open_constant(bus, GND, "stats: open");
+	if (dev == NULL) {
+		ADS1115_sim_destroy(bus);
+		return;
+		}
+	ADS1115_set_conversion_mode(dev, SINGLE);
+	ADS1115_set_pga(dev, PGA_4_096);
+	ADS1115_set_conversion_rate(dev, SPS_860);
+	ads1115_stats before;
+	ADS1115_get_stats(dev, &before);
+	const int i_conversions = 10;
+	for (int c = 0; c < i_conversions; c++) {
+		double d_volts;
+		ADS1115_get_single_conversion(dev, &d_volts);
+		}
+	ADS1115_get_stats(dev, &stats);
+	uint64_t ui64_histogram = 0;
+	for (int c = 0; c < ADS1115_LATENCY_BUCKETS; c++) {
+		ui64_histogram += stats.ui64arr_latency[c] - before.ui64arr_latency[c];
+		}
+	uint64_t ui64_conversions = stats.ui64_conversions - before.ui64_conversions;
+	uint64_t ui64_period = ADS1115_get_conversion_period_ns(dev);
+	test_check(ui64_conversions == (uint64_t)i_conversions && ui64_histogram == ui64_conversions, "stats: one histogram entry per conversion");
+	// a write and at least one read per conversion, 3 and 2 data bytes
+	test_check(stats.ui64_transfers - before.ui64_transfers >= 2 * ui64_conversions &&
+		stats.ui64_messages >= stats.ui64_transfers &&
+		stats.ui64_bytes - before.ui64_bytes >= 5 * ui64_conversions &&
+		stats.ui64_errors == 0 && stats.ui64_timeouts == 0, "stats: transport counters");
+	test_check((stats.ui64_latency_total_ns - before.ui64_latency_total_ns) / ui64_conversions >= ui64_period &&
+		stats.ui64_latency_max_ns >= ui64_period &&
+		ADS1115_stats_latency_percentile_ns(&stats, 50) >= ui64_period, "stats: latency no shorter than the conversion");
+	ADS1115_close(dev);
+
+	// nobody answers at SCL, every transaction fails
+	dev = ADS1115_sim_init(bus, 0, SCL);
+	if (dev != NULL) {
+		double d_volts;
+		ADS1115_get_stats(dev, &before);
+		int i_status = ADS1115_get_single_conversion(dev, &d_volts);
+		ADS1115_get_stats(dev, &stats);
+		test_check(i_status == ADS1115_ERROR_IO && stats.ui64_errors > before.ui64_errors, "stats: failed transactions counted");
+		ADS1115_close(dev);
+		}
+	ADS1115_sim_destroy(bus);
+	}
+
+void test_shm(void) {
+	// samples come out in order, a reader lapped by the publisher counts what it lost
+	char carr_name[32];
+	snprintf(carr_name, sizeof(carr_name), "/ads1115_test_%d", (int)getpid());
+	static ads1115_sample samples[3 * TEST_SHM_CAPACITY];
+	test_capture_samples(samples, 3 * TEST_SHM_CAPACITY);
+
+	ads1115_shm_publisher *publisher = ADS1115_shm_create(carr_name, TEST_SHM_CAPACITY, ADS1115_SHM_EXCLUSIVE);
+	test_check(publisher != NULL, "shm: create");
+	if (publisher == NULL) {
+		return;
+		}
+	test_check(ADS1115_shm_create(carr_name, TEST_SHM_CAPACITY, ADS1115_SHM_EXCLUSIVE) == NULL, "shm: name in use refused");
+	test_check(ADS1115_shm_create(carr_name, UINT32_MAX, ADS1115_SHM_REPLACE) == NULL, "shm: capacity past the limit refused");
+
+	// a reader starts with the next sample published
+	ADS1115_shm_publish(publisher, samples, 5);
+	ads1115_shm_reader *reader = ADS1115_shm_attach(carr_name);
+	test_check(reader != NULL, "shm: attach");
+	if (reader != NULL) {
+		ads1115_sample read[TEST_SHM_CAPACITY];
+		ADS1115_shm_publish(publisher, &samples[5], 10);
+		int i_read = ADS1115_shm_read(reader, read, TEST_SHM_CAPACITY);
+		int i_same = (i_read == 10);
+		for (int c = 0; c < i_read; c++) {
+			i_same &= test_samples_equal(&read[c], &samples[5 + c]);
+			}
+		test_check(i_same && ADS1115_shm_get_lost(reader) == 0, "shm: published samples read back in order");
+		test_check(ADS1115_shm_read(reader, read, TEST_SHM_CAPACITY) == 0, "shm: nothing new, nothing read");
+
+		// two and a half rings go by, the reader gets the last ring and loses the rest
+		int i_published = 5 * TEST_SHM_CAPACITY / 2;
+		ADS1115_shm_publish(publisher, samples, i_published);
+		int i_total = 0;
+		i_same = 1;
+		while ((i_read = ADS1115_shm_read(reader, read, TEST_SHM_CAPACITY)) > 0) {
+			for (int c = 0; c < i_read; c++) {
+				i_same &= test_samples_equal(&read[c], &samples[i_published - TEST_SHM_CAPACITY + i_total + c]);
+				}
+			i_total += i_read;
+			}
+		test_check(i_same && i_total == TEST_SHM_CAPACITY && ADS1115_shm_get_lost(reader) == (uint64_t)(i_published - TEST_SHM_CAPACITY), "shm: lapped reader skips ahead and counts the loss");
+		ADS1115_shm_detach(reader);
+		}
+
+	// a publisher that never destroyed its ring is taken over on request only
+	ads1115_shm_publisher *replacement = ADS1115_shm_create(carr_name, TEST_SHM_CAPACITY, ADS1115_SHM_REPLACE);
+	test_check(replacement != NULL, "shm: replace on request");
+	ADS1115_shm_destroy(publisher);
+	if (replacement != NULL) {
+		reader = ADS1115_shm_attach(carr_name);
+		test_check(reader != NULL, "shm: replaced publisher leaves the new ring in place");
+		if (reader != NULL) {
+			ADS1115_shm_detach(reader);
+			}
+		ADS1115_shm_destroy(replacement);
+		}
+	}
+
+int main(void) {
+	test_single_shot();
+	test_scan_sweep();
+	test_filter();
+	test_autorange();
+	test_adaptive();
+	test_adaptive_scan();
+	test_continuous();
+	test_comparator();
+	test_threshold_volts();
+	test_ready_mode();
+	test_capture();
+	test_group();
+	test_async();
+	test_staggered();
+	test_drift();
+	test_stats();
+	test_shm();
+	printf("%d failed\n", i_test_failures);
+	return (i_test_failures == 0) ? 0 : 1;
+	}